@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/atomic.h"
 #include "threads/malloc.h"
 
 /* A block device. */
@@ -17,8 +18,8 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    volatile int64_t read_cnt;          /* Number of sectors read. */
+    volatile int64_t write_cnt;         /* Number of sectors written. */
   };
 
 /* List of all block devices. */
@@ -122,7 +123,7 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
   block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  atomic64_inc (&block->read_cnt);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -136,7 +137,7 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
   block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  atomic64_inc (&block->write_cnt);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -171,7 +172,7 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          printf ("%s (%s): %lld reads, %lld writes\n",
                   block->name, block_type_name (block->type),
                   block->read_cnt, block->write_cnt);
         }
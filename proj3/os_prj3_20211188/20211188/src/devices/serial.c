@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <stdio.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -41,21 +41,75 @@
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Clear receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Clear transmit FIFO. */
+
 /* MODEM Control Register. */
 #define MCR_OUT2 0x08           /* Output line 2. */
 
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_TEMT 0x40           /* Transmitter Empty: FIFO and shifter idle. */
 
+/* Depth of the 16550A's transmit FIFO, in bytes. */
+#define TX_FIFO_SIZE 16
+
+/* Size of the transmit ring, in bytes.  Must be a power of 2. */
+#define TXQ_SIZE 8192
+
+/* Line rate, in bits per second.
+   Controlled by kernel command-line option "-bps=BPS". */
+static int line_rate = 9600;
+
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted.
+
+   A single-producer, single-consumer ring.  serial_putc() adds
+   bytes at TXQ_HEAD and the interrupt handler takes them off at
+   TXQ_TAIL.  Both indexes only ever grow, so the bytes in the
+   ring are those from TXQ_TAIL up to TXQ_HEAD, modulo TXQ_SIZE.
+   The producer only writes TXQ_HEAD and the consumer only writes
+   TXQ_TAIL, and each publishes its index after touching the
+   bytes, so neither waits for the other.
+
+   serial_putc() turns interrupts off while it adds a byte, but
+   only to keep out other producers: console output may come
+   from interrupt handlers too.  A writer that finds the ring
+   full sleeps until the handler makes room.  Only when the
+   handler cannot run, because interrupts are off, does anything
+   else drain the ring: then serial_putc() and serial_flush()
+   take its place and poll the bytes out themselves. */
+static uint8_t txq[TXQ_SIZE];
+static volatile uint32_t txq_head;
+static volatile uint32_t txq_tail;
+
+/* True while the transmit interrupt is enabled, that is, while
+   the interrupt handler is draining TXQ.  Cleared by the
+   handler when TXQ runs dry. */
+static bool tx_active;
+
+/* Thread sleeping until TXQ has room, if any. */
+static struct thread *tx_waiter;
+
+/* Number of bytes that may be written to THR without checking
+   LSR first: the transmit FIFO had at least this much room when
+   last looked at. */
+static int fifo_room;
+
+/* Statistics. */
+static long long intr_byte_cnt;         /* Bytes sent by the handler. */
+static long long xmit_intr_cnt;         /* Handler runs that sent any. */
+static long long poll_byte_cnt;         /* Bytes sent by polling. */
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void wait_fifo_room (void);
+static int fill_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,10 +122,9 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
-  set_serial (9600);                    /* 9.6 kbps, N-8-1. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+  set_serial (line_rate);               /* N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
   mode = POLL;
 } 
 
@@ -110,36 +163,102 @@ serial_putc (uint8_t byte)
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue a byte, waiting for room if the queue
+         is full. */
+      while (txq_head - txq_tail == TXQ_SIZE)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (old_level == INTR_OFF)
+            {
+              /* If we wanted to wait for the interrupt handler
+                 to make room, we'd have to reenable interrupts.
+                 That's impolite, so we'll send the oldest
+                 characters via polling instead.  The handler
+                 cannot run meanwhile. */
+              wait_fifo_room ();
+              poll_byte_cnt += fill_fifo ();
+            }
+          else if (tx_waiter == NULL)
+            {
+              tx_waiter = thread_current ();
+              thread_block ();
+            }
+          else
+            {
+              /* Another thread is already waiting.  Let it and
+                 the interrupt handler run. */
+              thread_yield ();
+            }
         }
+      txq[txq_head % TXQ_SIZE] = byte;
+      barrier ();
+      txq_head++;
 
-      intq_putc (&txq, byte); 
-      write_ier ();
+      /* Start the interrupt handler draining the queue, unless
+         it already is.  Only this costs an I/O port write. */
+      if (!tx_active)
+        {
+          tx_active = true;
+          write_ier ();
+        }
     }
   
   intr_set_level (old_level);
 }
 
-/* Flushes anything in the serial buffer out the port in polling
-   mode. */
+/* Waits until everything in the serial buffer has gone out the
+   port.  With interrupts on, the interrupt handler sends it;
+   with interrupts off, it is sent in polling mode. */
 void
 serial_flush (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  enum intr_level old_level;
+
+  if (intr_get_level () == INTR_ON)
+    {
+      while (txq_head != txq_tail)
+        barrier ();
+      return;
+    }
+
+  old_level = intr_disable ();
+  while (txq_head != txq_tail)
+    {
+      wait_fifo_room ();
+      poll_byte_cnt += fill_fifo ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Sets the line rate to BPS bits per second, which must divide
+   115,200.  Output already queued is sent at the old rate
+   first. */
+void
+serial_set_bps (int bps)
+{
+  enum intr_level old_level;
+
+  ASSERT (bps >= 300 && bps <= 115200 && 115200 % bps == 0);
+
+  old_level = intr_disable ();
+  line_rate = bps;
+  if (mode != UNINIT)
+    {
+      serial_flush ();
+      while ((inb (LSR_REG) & LSR_TEMT) == 0)
+        continue;
+      set_serial (line_rate);
+    }
   intr_set_level (old_level);
 }
 
+/* Prints serial port statistics. */
+void
+serial_print_stats (void)
+{
+  printf ("Serial: %lld bytes sent in %lld transmit interrupts, "
+          "%lld polled\n", intr_byte_cnt, xmit_intr_cnt, poll_byte_cnt);
+}
+
 /* The fullness of the input buffer may have changed.  Reassess
    whether we should block receive interrupts.
    Called by the input buffer routines when characters are added
@@ -182,7 +301,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (tx_active)
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -200,15 +319,63 @@ putc_poll (uint8_t byte)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  while ((inb (LSR_REG) & LSR_THRE) == 0)
-    continue;
+  wait_fifo_room ();
   outb (THR_REG, byte);
+  fifo_room--;
+}
+
+/* Polls the serial port until its transmit FIFO has room for at
+   least one byte. */
+static void
+wait_fifo_room (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (fifo_room == 0)
+    if ((inb (LSR_REG) & LSR_THRE) != 0)
+      fifo_room = TX_FIFO_SIZE;
+}
+
+/* Moves as many bytes from the queue into the transmit FIFO as
+   it is known to have room for, and returns the number moved.
+   Wakes up the thread waiting for room in the queue, if any,
+   once the queue is half empty.  This is the consumer side of
+   TXQ, so it must be called only from the interrupt handler or
+   with interrupts off. */
+static int
+fill_fifo (void)
+{
+  uint32_t tail = txq_tail;
+  uint32_t head = txq_head;
+  int cnt = 0;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  barrier ();
+  while (fifo_room > 0 && tail != head)
+    {
+      outb (THR_REG, txq[tail % TXQ_SIZE]);
+      tail++;
+      fifo_room--;
+      cnt++;
+    }
+  barrier ();
+  txq_tail = tail;
+
+  if (tx_waiter != NULL && txq_head - tail <= TXQ_SIZE / 2)
+    {
+      thread_unblock (tx_waiter);
+      tx_waiter = NULL;
+    }
+  return cnt;
 }
 
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
 {
+  int cnt;
+
   /* Inquire about interrupt in UART.  Without this, we can
      occasionally miss an interrupt running under QEMU. */
   inb (IIR_REG);
@@ -218,10 +385,19 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO is empty, refill all of it at once,
+     without checking LSR between bytes.  Stop interrupting for
+     transmission once the queue runs dry. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0)
+    fifo_room = TX_FIFO_SIZE;
+  cnt = fill_fifo ();
+  if (cnt > 0)
+    {
+      intr_byte_cnt += cnt;
+      xmit_intr_cnt++;
+    }
+  if (txq_head == txq_tail)
+    tx_active = false;
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -4,9 +4,11 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "threads/atomic.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 #define fraction (1<<14)
@@ -18,17 +20,48 @@
 #endif
 
 /* Number of timer ticks since OS booted. */
-static int64_t ticks;
-
-/* Number of loops per timer tick.
+static volatile int64_t ticks;
+
+/* Tickless idle.  Rather than take an interrupt on every tick
+   while the CPU has nothing to do, timer_idle_enter() programs
+   the PIT to interrupt once, at the next tick on which something
+   is due, and the ticks in between are counted all at once when
+   the CPU wakes up.  The PIT counter is 16 bits, so one interrupt
+   can stand in for at most TICKLESS_MAX_TICKS ticks.
+
+   Not used with -mlfqs or -aging, whose per-tick bookkeeping
+   assumes every tick is seen. */
+#define PIT_TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (65535 / PIT_TICK_CYCLES)
+static unsigned oneshot_cycles; /* PIT cycles programmed, 0 if periodic. */
+static unsigned oneshot_first;  /* Of those, cycles until first tick. */
+static int64_t oneshot_ticks;   /* Ticks the one-shot stands in for. */
+static int64_t skipped_ticks;   /* Ticks with no timer interrupt. */
+
+/* High-resolution clock, driven by the CPU's time-stamp counter.
    Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+#define NSEC_PER_SEC 1000000000LL
+#define CALIBRATE_TICKS 5       /* Ticks to measure the TSC over. */
+static uint64_t tsc_hz;         /* TSC cycles per second, 0 if unknown. */
+static uint64_t tsc_base;       /* TSC value at tick 0. */
+
+/* Threads in sub-tick sleeps, ordered by wake_ns.  Woken by a
+   one-shot PIT interrupt in the middle of a tick, programmed by
+   hires_arm(). */
+static struct list hires_sleepers;
+
+/* Minimum PIT cycles to program for a mid-tick interrupt.  Less
+   than this and the interrupt could arrive before we are ready
+   for it. */
+#define HIRES_MIN_CYCLES 16
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void skip_ticks (int64_t cnt);
+static void hires_sleep (int64_t ns);
+static void hires_wake (void);
+static void hires_arm (unsigned left, bool periodic);
 
 
 struct list sleep_a;
@@ -40,43 +73,50 @@ timer_init (void)
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
   list_init(&sleep_a);
+  list_init (&hires_sleepers);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Calibrates the TSC against the timer, so that timer_now_ns()
+   and brief delays can use it. */
 void
 timer_calibrate (void) 
 {
-  unsigned high_bit, test_bit;
+  int64_t start;
+  uint64_t tsc_start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
-  /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-  loops_per_tick = 1u << 10;
-  while (!too_many_loops (loops_per_tick << 1)) 
-    {
-      loops_per_tick <<= 1;
-      ASSERT (loops_per_tick != 0);
-    }
+  /* Count TSC cycles over CALIBRATE_TICKS ticks, starting right
+     at a tick. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+  start = timer_ticks ();
+  tsc_start = rdtsc ();
+  while (timer_ticks () - start < CALIBRATE_TICKS)
+    barrier ();
 
-  /* Refine the next 8 bits of loops_per_tick. */
-  high_bit = loops_per_tick;
-  for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-    if (!too_many_loops (loops_per_tick | test_bit))
-      loops_per_tick |= test_bit;
+  tsc_hz = (rdtsc () - tsc_start) * TIMER_FREQ / CALIBRATE_TICKS;
+  tsc_base = tsc_start - start * tsc_hz / TIMER_FREQ;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" TSC cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
-  return t;
+  return atomic64_read (&ticks);
 }
 
 /* Returns the number of timer ticks elapsed since THEN, which
@@ -86,6 +126,23 @@ timer_elapsed (int64_t then)
 {
   return timer_ticks () - then;
 }
+
+/* Returns the number of nanoseconds since the OS booted.  Until
+   timer_calibrate() has run, this only has tick resolution. */
+int64_t
+timer_now_ns (void)
+{
+  uint64_t cycles;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+
+  /* Split the conversion so that the multiplication cannot
+     overflow. */
+  cycles = rdtsc () - tsc_base;
+  return (cycles / tsc_hz * NSEC_PER_SEC
+          + cycles % tsc_hz * NSEC_PER_SEC / tsc_hz);
+}
 bool less_wake_time(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
     const struct thread *thread_a = list_entry(a, struct thread, elem);
     const struct thread *thread_b = list_entry(b, struct thread, elem);
@@ -177,15 +234,125 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks (%"PRId64" skipped while idle)\n",
+          timer_ticks (), skipped_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If nothing is due for a while, switches the PIT
+   to a one-shot interrupt at the next deadline. */
+void
+timer_idle_enter (void)
+{
+  int64_t deadline, cnt;
+  unsigned first;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs || thread_aging || oneshot_cycles != 0
+      || !list_empty (&hires_sleepers))
+    return;
+
+  deadline = workqueue_next_deadline ();
+  if (!list_empty (&sleep_a))
+    {
+      struct thread *t = list_entry (list_front (&sleep_a),
+                                     struct thread, elem);
+      if (t->wake_time < deadline)
+        deadline = t->wake_time;
+    }
+
+  /* Ticks until DEADLINE.  Not worth it for just one. */
+  cnt = deadline - ticks;
+  if (cnt > TICKLESS_MAX_TICKS)
+    cnt = TICKLESS_MAX_TICKS;
+  if (cnt < 2)
+    return;
+
+  /* Keep the tick phase: the first tick is however far off the
+     periodic counter says, the rest are whole periods. */
+  first = pit_read_count (0);
+  if (first == 0 || first > PIT_TICK_CYCLES)
+    first = PIT_TICK_CYCLES;
+
+  oneshot_first = first;
+  oneshot_ticks = cnt;
+  oneshot_cycles = first + (cnt - 1) * PIT_TICK_CYCLES;
+  pit_start_oneshot (0, oneshot_cycles);
+}
+
+/* Called by the idle thread once the CPU wakes up.  If something
+   other than the timer woke it, counts the ticks that passed and
+   goes back to periodic interrupts. */
+void
+timer_idle_exit (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  /* Only timer_idle_enter() programs one-shots of more than one
+     tick; shorter ones belong to sub-tick sleepers. */
+  if (oneshot_cycles != 0 && oneshot_ticks > 1)
+    {
+      unsigned left = pit_read_count (0);
+
+      /* If the count already ran out, the timer interrupt is
+         pending and will do the accounting itself. */
+      if (left != 0 && left < oneshot_cycles)
+        {
+          unsigned elapsed = oneshot_cycles - left;
+          int64_t cnt = 0;
+
+          if (elapsed >= oneshot_first)
+            cnt = 1 + (elapsed - oneshot_first) / PIT_TICK_CYCLES;
+          oneshot_cycles = 0;
+          pit_configure_channel (0, 2, TIMER_FREQ);
+          skip_ticks (cnt);
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Counts CNT ticks that passed without a timer interrupt, all
+   of them spent idle. */
+static void
+skip_ticks (int64_t cnt)
+{
+  if (cnt <= 0)
+    return;
+  atomic64_fetch_add (&ticks, cnt);
+  skipped_ticks += cnt;
+  thread_skip_ticks (cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
+  /* A one-shot interrupt in the middle of a tick is only for
+     sub-tick sleepers.  The next one-shot takes us on to the
+     end of the tick. */
+  if (oneshot_cycles != 0 && oneshot_ticks == 0)
+    {
+      unsigned left = oneshot_first - oneshot_cycles;
+
+      oneshot_cycles = 0;
+      hires_wake ();
+      hires_arm (left, false);
+      return;
+    }
+
+  /* Otherwise a one-shot interrupt stands for ONESHOT_TICKS
+     ticks, of which only the last is handled below. */
+  if (oneshot_cycles != 0)
+    {
+      oneshot_cycles = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      skip_ticks (oneshot_ticks - 1);
+    }
+
+  atomic64_inc (&ticks);
   thread_tick ();
+  workqueue_tick (ticks);
 
   for (struct list_elem *iter = list_begin(&sleep_a); 
        iter != list_end(&sleep_a); ) {
@@ -198,6 +365,10 @@ timer_interrupt (struct intr_frame *args UNUSED)
     }
   }
 
+  hires_wake ();
+  if (!list_empty (&hires_sleepers))
+    hires_arm (pit_read_count (0), true);
+
   if (thread_aging || thread_mlfqs) {
     thread_current()->recent_cpu += fraction;
     if (timer_ticks() % TIMER_FREQ == 0) {
@@ -210,37 +381,100 @@ timer_interrupt (struct intr_frame *args UNUSED)
   }
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Returns true if A's sub-tick wake-up time is before B's. */
 static bool
-too_many_loops (unsigned loops) 
+less_wake_ns (const struct list_elem *a, const struct list_elem *b,
+              void *aux UNUSED)
 {
-  /* Wait for a timer tick. */
-  int64_t start = ticks;
-  while (ticks == start)
-    barrier ();
-
-  /* Run LOOPS loops. */
-  start = ticks;
-  busy_wait (loops);
+  return (list_entry (a, struct thread, elem)->wake_ns
+          < list_entry (b, struct thread, elem)->wake_ns);
+}
 
-  /* If the tick count changed, we iterated too long. */
-  barrier ();
-  return start != ticks;
+/* Sleeps for NS nanoseconds, less than one tick, by blocking
+   until a one-shot timer interrupt wakes us. */
+static void
+hires_sleep (int64_t ns)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  cur->wake_ns = timer_now_ns () + ns;
+  list_insert_ordered (&hires_sleepers, &cur->elem, less_wake_ns, NULL);
+
+  /* If the PIT is in periodic mode, interrupt it in the middle
+     of this tick.  Otherwise a one-shot is already programmed,
+     and every timer interrupt re-arms for the sleepers. */
+  if (oneshot_cycles == 0)
+    hires_arm (pit_read_count (0), true);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Wakes up sub-tick sleepers whose time has come.  Called from
+   the timer interrupt handler. */
+static void
+hires_wake (void)
+{
+  int64_t now = timer_now_ns ();
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) 
+  while (!list_empty (&hires_sleepers))
+    {
+      struct thread *t = list_entry (list_front (&hires_sleepers),
+                                     struct thread, elem);
+      if (t->wake_ns > now)
+        break;
+      list_pop_front (&hires_sleepers);
+      thread_unblock (t);
+
+      /* Don't make it wait for the end of the time slice. */
+      if (t->priority > thread_current ()->priority)
+        intr_yield_on_return ();
+    }
+}
+
+/* Programs the PIT for the next sub-tick sleeper, given that the
+   next tick is LEFT PIT cycles away.  If the first sleeper is due
+   before then, arms a one-shot interrupt for it; the interrupt
+   handler calls back here for the rest of the tick.  Otherwise,
+   unless the PIT is still PERIODIC, arms a one-shot for the tick
+   itself.  Interrupts must be off. */
+static void
+hires_arm (unsigned left, bool periodic)
 {
-  while (loops-- > 0)
-    barrier ();
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (left == 0 || left > PIT_TICK_CYCLES)
+    left = PIT_TICK_CYCLES;
+
+  if (!list_empty (&hires_sleepers))
+    {
+      struct thread *t = list_entry (list_front (&hires_sleepers),
+                                     struct thread, elem);
+      int64_t ns = t->wake_ns - timer_now_ns ();
+      int64_t wait = DIV_ROUND_UP (ns * PIT_HZ, NSEC_PER_SEC);
+
+      if (wait < HIRES_MIN_CYCLES)
+        wait = HIRES_MIN_CYCLES;
+      if (wait < left)
+        {
+          oneshot_first = left;
+          oneshot_ticks = 0;
+          oneshot_cycles = wait;
+          pit_start_oneshot (0, wait);
+          return;
+        }
+    }
+
+  /* timer_interrupt() treats a one-shot for a single tick like
+     an ordinary tick, and goes back to periodic mode. */
+  if (!periodic)
+    {
+      oneshot_first = left;
+      oneshot_ticks = 1;
+      oneshot_cycles = left;
+      pit_start_oneshot (0, left);
+    }
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -263,20 +497,29 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
-  else 
+  else if (tsc_hz != 0)
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
-      real_time_delay (num, denom); 
+      /* Otherwise, block until a one-shot interrupt partway
+         through the tick, for accurate sub-tick timing. */
+      ASSERT (denom % 1000 == 0);
+      if (num > 0)
+        hires_sleep (num * (NSEC_PER_SEC / 1000) / (denom / 1000));
     }
+  else
+    real_time_delay (num, denom);
 }
 
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
+  uint64_t start, cycles;
+
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
+  start = rdtsc ();
+  cycles = tsc_hz * num / 1000 / (denom / 1000);
+  while (rdtsc () - start < cycles)
+    asm volatile ("pause");
 }
@@ -1,7 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 /* An open file. */
 struct file 
@@ -12,25 +12,46 @@ struct file
     struct semaphore file_lock;           /* Has file_deny_write() been called? */
   };
 
+/* Cache of struct file. */
+static struct kmem_cache *file_cache;
+
+/* Constructs struct file F_ in FILE_CACHE.  Files are freed with
+   FILE_LOCK released, so it stays initialized from then on. */
+static void
+file_ctor (void *f_)
+{
+  struct file *f = f_;
+  sema_init (&f->file_lock, 1);
+}
+
+/* Initializes the file module. */
+void
+file_init (void)
+{
+  file_cache = kmem_cache_create ("file", sizeof (struct file), 0,
+                                  file_ctor);
+  if (file_cache == NULL)
+    PANIC ("cannot create file cache");
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = kmem_cache_alloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
-      sema_init(&file->file_lock, 1);
       return file;
     }
   else
     {
       inode_close (inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
       return NULL; 
     }
 }
@@ -51,7 +72,8 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      ASSERT (file->file_lock.value == 1);
+      kmem_cache_free (file_cache, file);
     }
 }
 
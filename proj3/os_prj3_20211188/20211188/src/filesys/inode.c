@@ -6,6 +6,10 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -36,6 +40,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned version;                   /* Bumped by every write. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -57,11 +62,19 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of struct inode.  Each one carries a whole sector of
+   on-disk inode, which would waste most of a 1 kB malloc()
+   block. */
+static struct kmem_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), 0, NULL);
+  if (inode_cache == NULL)
+    PANIC ("cannot create inode cache");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -127,7 +140,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -136,6 +149,7 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->version = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
@@ -181,7 +195,7 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (inode_cache, inode);
     }
 }
 
@@ -192,6 +206,11 @@ inode_remove (struct inode *inode)
 {
   ASSERT (inode != NULL);
   inode->removed = true;
+#ifdef USERPROG
+  /* exec()'s header cache holds INODE open, which would keep its
+     sectors allocated until the entry happened to be evicted. */
+  process_forget_executable (inode);
+#endif
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -314,6 +333,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     }
   free (bounce);
 
+  /* Bump the version only after the data is on disk, so that
+     anyone who sampled the old version before reading will see
+     that it changed. */
+  if (bytes_written > 0)
+    inode->version++;
+
   return bytes_written;
 }
 
@@ -337,6 +362,15 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns INODE's version, which changes whenever INODE's data
+   is written.  Lets callers cache what they derive from an
+   inode's contents. */
+unsigned
+inode_version (const struct inode *inode)
+{
+  return inode->version;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
@@ -0,0 +1,204 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Our heap is a pairing heap: a tree, not necessarily binary,
+   in which no element is less than its parent.  Each element
+   points to its first child, and the children of an element
+   form a doubly linked list through NEXT and PREV, except that
+   the first child's PREV points to the parent.  The root's NEXT
+   and PREV are null.
+
+   Two trees are "melded" by making the root that is not less
+   the first child of the other.  Inserting melds the new element
+   with the root.  Popping the root leaves its children as a
+   list of trees, which are melded in pairs from left to right
+   and then the pairs from right to left; doing it in two passes
+   like this is what gives the O(log n) amortized bound. */
+
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+                               struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void detach (struct heap_elem *);
+
+/* Initializes H as an empty heap that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->size = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = meld (h, h->root, e);
+  h->size++;
+}
+
+/* Removes the front element from H and returns it.  H must not
+   be empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *front;
+
+  ASSERT (!heap_empty (h));
+
+  front = h->root;
+  h->root = merge_pairs (h, front->child);
+  h->size--;
+  return front;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (!heap_empty (h));
+  ASSERT (e != NULL);
+
+  if (e == h->root)
+    heap_pop (h);
+  else
+    {
+      detach (e);
+      h->root = meld (h, h->root, merge_pairs (h, e->child));
+      h->size--;
+    }
+}
+
+/* Restores H's order after E, which must be in H, has changed so
+   that it compares less than before, that is, so that it should
+   come out earlier. */
+void
+heap_decrease (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (!heap_empty (h));
+  ASSERT (e != NULL);
+
+  /* E's children are still in order with respect to E, so E and
+     its subtree can be cut out and melded back in whole. */
+  if (e != h->root)
+    {
+      detach (e);
+      h->root = meld (h, h->root, e);
+    }
+}
+
+/* Returns the front element of H, which must not be empty,
+   without removing it. */
+struct heap_elem *
+heap_front (const struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+  return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  ASSERT (h != NULL);
+  return h->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings or parents. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (h->less (b, a, h->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of sibling trees starting at FIRST into one
+   tree, whose root is returned.  Returns a null pointer if FIRST
+   is null. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* Left to right, meld each pair of trees, and stack up the
+     results, linked through NEXT. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *m;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+      m = meld (h, a, b);
+      m->next = pairs;
+      pairs = m;
+    }
+
+  /* Right to left, meld the pairs into one tree. */
+  while (pairs != NULL)
+    {
+      struct heap_elem *m = pairs;
+
+      pairs = m->next;
+      m->next = NULL;
+      root = meld (h, root, m);
+    }
+
+  return root;
+}
+
+/* Cuts E, which must not be the root, and its subtree out of its
+   parent's list of children. */
+static void
+detach (struct heap_elem *e)
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
@@ -0,0 +1,92 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+
+   This is a pairing heap, a tree in which every element is
+   ordered before its children, kept as a linked structure so
+   that, like the linked list in list.h, it needs no dynamically
+   allocated memory.  Each structure that can be in a heap must
+   embed a struct heap_elem member, and heap_entry() converts a
+   struct heap_elem back into the structure that contains it:
+
+      struct foo
+        {
+          struct heap_elem elem;
+          int priority;
+          ...other members...
+        };
+
+   The heap's comparison function decides the order: the element
+   at the front of the heap is one that no other element is
+   "less" than.  For example, to pop the highest priority first:
+
+      static bool
+      foo_higher (const struct heap_elem *a_,
+                  const struct heap_elem *b_, void *aux UNUSED)
+      {
+        const struct foo *a = heap_entry (a_, struct foo, elem);
+        const struct foo *b = heap_entry (b_, struct foo, elem);
+        return a->priority > b->priority;
+      }
+
+   Inserting takes O(1) time.  Popping the front, or removing any
+   other element, takes O(log n) amortized time.  So does moving
+   an element toward the front after its key changes in that
+   direction; a key that moves the other way needs a remove and
+   reinsert.  See [Fredman86].
+
+   Elements that compare equal do not come out in any particular
+   order.  To pop them in insertion order, have the comparison
+   function break ties with a sequence number. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* First child. */
+    struct heap_elem *next;     /* Next sibling. */
+    struct heap_elem *prev;     /* Previous sibling, or parent if first. */
+  };
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A should come out of the
+   heap before B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Front element, or null if empty. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for LESS. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) (HEAP_ELEM)            \
+                     - offsetof (STRUCT, MEMBER)))
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_decrease (struct heap *, struct heap_elem *);
+
+/* Information. */
+struct heap_elem *heap_front (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
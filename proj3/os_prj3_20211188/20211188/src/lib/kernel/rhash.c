@@ -0,0 +1,493 @@
+/* Open-addressing hash table.
+
+   See rhash.h for basic information. */
+
+#include "rhash.h"
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Smallest number of slots. */
+#define MIN_SLOTS 8
+
+/* Slots in the old array moved per insertion or deletion while
+   the table is being resized.  Growing starts with the new array
+   3/8 full, so moving at least 2 slots per insertion empties the
+   old array before the new one needs to grow in turn. */
+#define MIGRATE_SLOTS 8
+
+/* A slot in the old array whose element has been moved or
+   deleted.  It keeps its hash value, so that searches of the old
+   array still know how far to probe past it. */
+static struct hash_elem moved_elem;
+#define MOVED (&moved_elem)
+
+static struct rhash_slot *lookup (struct rhash *, struct hash_elem *,
+                                  unsigned hash, struct rhash_table **);
+static void insert_slot (struct rhash_table *, unsigned hash,
+                         struct hash_elem *);
+static void remove_slot (struct rhash *, struct rhash_table *,
+                         struct rhash_slot *);
+static bool alloc_table (struct rhash_table *, size_t slot_cnt);
+static void migrate (struct rhash *, size_t slot_cnt);
+static void make_room (struct rhash *);
+static void maybe_shrink (struct rhash *);
+static struct hash_elem *slot_at (struct rhash *, size_t pos);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+rhash_init (struct rhash *h,
+            hash_hash_func *hash, hash_less_func *less, void *aux) 
+{
+  h->elem_cnt = 0;
+  h->old.slots = NULL;
+  h->old.slot_cnt = 0;
+  h->old_cnt = 0;
+  h->migrate_idx = 0;
+  h->hash = hash;
+  h->less = less;
+  h->aux = aux;
+  return alloc_table (&h->cur, MIN_SLOTS);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while rhash_clear() is running, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), or rhash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere. */
+void
+rhash_clear (struct rhash *h, hash_action_func *destructor) 
+{
+  if (destructor != NULL)
+    rhash_apply (h, destructor);
+
+  free (h->old.slots);
+  h->old.slots = NULL;
+  h->old.slot_cnt = 0;
+  h->old_cnt = 0;
+  memset (h->cur.slots, 0, sizeof *h->cur.slots * h->cur.slot_cnt);
+  h->elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, as in rhash_clear(). */
+void
+rhash_destroy (struct rhash *h, hash_action_func *destructor) 
+{
+  if (destructor != NULL)
+    rhash_apply (h, destructor);
+  free (h->old.slots);
+  free (h->cur.slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW.
+
+   If memory to grow the table cannot be allocated, the table
+   keeps filling its current array, and the kernel panics if that
+   becomes completely full. */
+struct hash_elem *
+rhash_insert (struct rhash *h, struct hash_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct rhash_table *table;
+  struct rhash_slot *slot;
+
+  migrate (h, MIGRATE_SLOTS);
+  slot = lookup (h, new, hash, &table);
+  if (slot != NULL)
+    return slot->elem;
+
+  make_room (h);
+  insert_slot (&h->cur, hash, new);
+  h->elem_cnt++;
+  return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct hash_elem *
+rhash_replace (struct rhash *h, struct hash_elem *new) 
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct rhash_table *table;
+  struct rhash_slot *slot;
+  struct hash_elem *old;
+
+  migrate (h, MIGRATE_SLOTS);
+  slot = lookup (h, new, hash, &table);
+  if (slot != NULL && table == &h->cur)
+    {
+      /* Equal elements have equal hashes, so NEW can simply take
+         OLD's slot. */
+      old = slot->elem;
+      slot->elem = new;
+      return old;
+    }
+
+  old = slot != NULL ? slot->elem : NULL;
+  if (slot != NULL)
+    remove_slot (h, table, slot);
+  make_room (h);
+  insert_slot (&h->cur, hash, new);
+  h->elem_cnt++;
+  return old;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+rhash_find (struct rhash *h, struct hash_elem *e) 
+{
+  struct rhash_table *table;
+  struct rhash_slot *slot = lookup (h, e, h->hash (e, h->aux), &table);
+
+  return slot != NULL ? slot->elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct hash_elem *
+rhash_delete (struct rhash *h, struct hash_elem *e)
+{
+  struct rhash_table *table;
+  struct rhash_slot *slot;
+  struct hash_elem *found = NULL;
+
+  migrate (h, MIGRATE_SLOTS);
+  slot = lookup (h, e, h->hash (e, h->aux), &table);
+  if (slot != NULL)
+    {
+      found = slot->elem;
+      remove_slot (h, table, slot);
+      maybe_shrink (h);
+    }
+  return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while rhash_apply() is running, using
+   any of the functions rhash_clear(), rhash_destroy(),
+   rhash_insert(), rhash_replace(), or rhash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+rhash_apply (struct rhash *h, hash_action_func *action) 
+{
+  size_t pos;
+
+  ASSERT (action != NULL);
+
+  for (pos = 0; pos < h->cur.slot_cnt + h->old.slot_cnt; pos++)
+    {
+      struct hash_elem *e = slot_at (h, pos);
+      if (e != NULL)
+        action (e, h->aux);
+    }
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+      struct rhash_iterator i;
+
+      rhash_first (&i, h);
+      while (rhash_next (&i))
+        {
+          struct foo *f = hash_entry (rhash_cur (&i), struct foo, elem);
+          ...do something with f...
+        }
+
+   Modifying hash table H during iteration, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), or rhash_delete(), invalidates all
+   iterators. */
+void
+rhash_first (struct rhash_iterator *i, struct rhash *h) 
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->hash = h;
+  i->pos = 0;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct hash_elem *
+rhash_next (struct rhash_iterator *i)
+{
+  struct rhash *h;
+
+  ASSERT (i != NULL);
+
+  h = i->hash;
+  i->elem = NULL;
+  while (i->elem == NULL && i->pos < h->cur.slot_cnt + h->old.slot_cnt)
+    i->elem = slot_at (h, i->pos++);
+  return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling rhash_first() but before rhash_next(). */
+struct hash_elem *
+rhash_cur (struct rhash_iterator *i) 
+{
+  return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+rhash_size (struct rhash *h) 
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+rhash_empty (struct rhash *h) 
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns how far the element with hash value HASH in slot IDX
+   of TABLE is from its home slot. */
+static inline size_t
+distance (const struct rhash_table *table, unsigned hash, size_t idx) 
+{
+  return (idx - hash) & (table->slot_cnt - 1);
+}
+
+/* Searches TABLE in H for an element equal to E, whose hash
+   value is HASH.  Returns its slot if found, otherwise a null
+   pointer. */
+static struct rhash_slot *
+lookup_table (struct rhash *h, struct rhash_table *table,
+              struct hash_elem *e, unsigned hash) 
+{
+  size_t mask = table->slot_cnt - 1;
+  size_t idx, dist;
+
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
+    {
+      struct rhash_slot *slot = &table->slots[idx];
+
+      /* E would have displaced any element nearer its home. */
+      if (slot->elem == NULL || distance (table, slot->hash, idx) < dist)
+        return NULL;
+      if (slot->hash == hash && slot->elem != MOVED
+          && !h->less (slot->elem, e, h->aux)
+          && !h->less (e, slot->elem, h->aux))
+        return slot;
+    }
+}
+
+/* Searches H for an element equal to E, whose hash value is
+   HASH.  Returns its slot and stores the array it is in into
+   *TABLE if found, otherwise returns a null pointer. */
+static struct rhash_slot *
+lookup (struct rhash *h, struct hash_elem *e, unsigned hash,
+        struct rhash_table **table) 
+{
+  struct rhash_slot *slot;
+
+  *table = &h->cur;
+  slot = lookup_table (h, &h->cur, e, hash);
+  if (slot == NULL && h->old.slots != NULL)
+    {
+      *table = &h->old;
+      slot = lookup_table (h, &h->old, e, hash);
+    }
+  return slot;
+}
+
+/* Inserts E, whose hash value is HASH, into TABLE, which must
+   have an empty slot and no moved slots. */
+static void
+insert_slot (struct rhash_table *table, unsigned hash, struct hash_elem *e) 
+{
+  size_t mask = table->slot_cnt - 1;
+  size_t idx, dist;
+
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
+    {
+      struct rhash_slot *slot = &table->slots[idx];
+      size_t slot_dist;
+
+      if (slot->elem == NULL)
+        {
+          slot->hash = hash;
+          slot->elem = e;
+          return;
+        }
+
+      /* Take the slot from an element nearer its home, and
+         carry on inserting that element instead. */
+      slot_dist = distance (table, slot->hash, idx);
+      if (slot_dist < dist)
+        {
+          struct rhash_slot displaced = *slot;
+
+          slot->hash = hash;
+          slot->elem = e;
+          hash = displaced.hash;
+          e = displaced.elem;
+          dist = slot_dist;
+        }
+    }
+}
+
+/* Removes SLOT, which is in TABLE, from H. */
+static void
+remove_slot (struct rhash *h, struct rhash_table *table,
+             struct rhash_slot *slot) 
+{
+  h->elem_cnt--;
+  if (table == &h->old)
+    {
+      /* Leave a marker, since moving later elements back would
+         move some of them behind migrate_idx. */
+      slot->elem = MOVED;
+      h->old_cnt--;
+    }
+  else
+    {
+      /* Shift the following elements back a slot, until one
+         that is already in its home slot, so that no search
+         stops early at the hole. */
+      size_t mask = table->slot_cnt - 1;
+      size_t idx = slot - table->slots;
+
+      for (;;)
+        {
+          size_t next = (idx + 1) & mask;
+          struct rhash_slot *next_slot = &table->slots[next];
+
+          if (next_slot->elem == NULL
+              || distance (table, next_slot->hash, next) == 0)
+            break;
+          table->slots[idx] = *next_slot;
+          idx = next;
+        }
+      table->slots[idx].elem = NULL;
+    }
+}
+
+/* Allocates SLOT_CNT empty slots for TABLE.  Returns true if
+   successful, false if memory is short. */
+static bool
+alloc_table (struct rhash_table *table, size_t slot_cnt) 
+{
+  table->slots = calloc (slot_cnt, sizeof *table->slots);
+  table->slot_cnt = table->slots != NULL ? slot_cnt : 0;
+  return table->slots != NULL;
+}
+
+/* Starts resizing H to SLOT_CNT slots, unless memory is short,
+   in which case H is left alone. */
+static void
+start_resize (struct rhash *h, size_t slot_cnt) 
+{
+  struct rhash_table new;
+
+  ASSERT (h->old.slots == NULL);
+  if (!alloc_table (&new, slot_cnt))
+    return;
+
+  h->old = h->cur;
+  h->old_cnt = h->elem_cnt;
+  h->migrate_idx = 0;
+  h->cur = new;
+}
+
+/* Moves the elements in up to SLOT_CNT slots of H's old array
+   into its current array, and frees the old array once it has
+   no elements left. */
+static void
+migrate (struct rhash *h, size_t slot_cnt) 
+{
+  if (h->old.slots == NULL)
+    return;
+
+  for (; slot_cnt > 0 && h->old_cnt > 0; slot_cnt--)
+    {
+      struct rhash_slot *slot = &h->old.slots[h->migrate_idx++];
+
+      if (slot->elem != NULL && slot->elem != MOVED)
+        {
+          insert_slot (&h->cur, slot->hash, slot->elem);
+          slot->elem = MOVED;
+          h->old_cnt--;
+        }
+    }
+
+  if (h->old_cnt == 0)
+    {
+      free (h->old.slots);
+      h->old.slots = NULL;
+      h->old.slot_cnt = 0;
+    }
+}
+
+/* Makes sure that H's current array has room for one more
+   element, growing it when it would become more than 3/4 full. */
+static void
+make_room (struct rhash *h) 
+{
+  if ((h->elem_cnt + 1) * 4 <= h->cur.slot_cnt * 3)
+    return;
+
+  /* Only a run of insertions after shrinking can get here while
+     the old array is still in use.  Finish with it first. */
+  if (h->old.slots != NULL)
+    migrate (h, h->old.slot_cnt);
+
+  start_resize (h, h->cur.slot_cnt * 2);
+  if (h->elem_cnt + 1 >= h->cur.slot_cnt)
+    PANIC ("rhash: out of memory");
+}
+
+/* Starts shrinking H if its current array is less than 1/8
+   full, so that it ends up half full. */
+static void
+maybe_shrink (struct rhash *h) 
+{
+  if (h->old.slots == NULL
+      && h->cur.slot_cnt > MIN_SLOTS
+      && h->elem_cnt * 8 < h->cur.slot_cnt)
+    start_resize (h, h->cur.slot_cnt / 4 > MIN_SLOTS
+                     ? h->cur.slot_cnt / 4 : MIN_SLOTS);
+}
+
+/* Returns the element at position POS in H, counting the slots
+   of the current array and then those of the old one, or a null
+   pointer if that slot is empty. */
+static struct hash_elem *
+slot_at (struct rhash *h, size_t pos) 
+{
+  struct hash_elem *e;
+
+  if (pos < h->cur.slot_cnt)
+    e = h->cur.slots[pos].elem;
+  else
+    e = h->old.slots[pos - h->cur.slot_cnt].elem;
+  return e != MOVED ? e : NULL;
+}
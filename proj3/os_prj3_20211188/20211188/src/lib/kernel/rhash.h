@@ -0,0 +1,93 @@
+#ifndef __LIB_KERNEL_RHASH_H
+#define __LIB_KERNEL_RHASH_H
+
+/* Open-addressing hash table.
+
+   This is an alternative to the chained hash table in hash.h,
+   with the same element type and the same hash and comparison
+   functions, so that a table can be switched from one to the
+   other by changing only the table type and the names of the
+   calls.
+
+   Elements live in a single array of slots, each holding an
+   element pointer and its hash value, and collisions are
+   resolved by linear probing with "Robin Hood" insertion: an
+   element being inserted takes the slot of any element that is
+   closer to its home slot, which then moves on instead.  This
+   keeps every probe sequence short, and lets a search stop as
+   soon as it passes where the element would have been.  See
+   [Celis86].
+
+   When the table grows or shrinks, the new array is filled a
+   few slots at a time by each later insertion or deletion,
+   rather than all at once, so that no single operation has to
+   move every element.  Until that is done, searches look in both
+   arrays.
+
+   As with hash.h, each structure that can be in a table must
+   embed a struct hash_elem member, and hash_entry() converts a
+   struct hash_elem back into the structure that contains it.
+   The table never allocates memory for elements. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hash.h"
+
+/* A slot in an array of slots. */
+struct rhash_slot
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    struct hash_elem *elem;     /* Element, or null if empty. */
+  };
+
+/* An array of slots. */
+struct rhash_table
+  {
+    struct rhash_slot *slots;   /* Slots, or null if none. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+  };
+
+/* Open-addressing hash table. */
+struct rhash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    struct rhash_table cur;     /* Slots that new elements go into. */
+    struct rhash_table old;     /* Slots being emptied into CUR. */
+    size_t old_cnt;             /* Elements still in OLD. */
+    size_t migrate_idx;         /* Next slot in OLD to move. */
+    hash_hash_func *hash;       /* Hash function. */
+    hash_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `less'. */
+  };
+
+/* An open-addressing hash table iterator. */
+struct rhash_iterator
+  {
+    struct rhash *hash;         /* The hash table. */
+    size_t pos;                 /* Slot in CUR, then in OLD. */
+    struct hash_elem *elem;     /* Current hash element. */
+  };
+
+/* Basic life cycle. */
+bool rhash_init (struct rhash *, hash_hash_func *, hash_less_func *,
+                 void *aux);
+void rhash_clear (struct rhash *, hash_action_func *);
+void rhash_destroy (struct rhash *, hash_action_func *);
+
+/* Search, insertion, deletion. */
+struct hash_elem *rhash_insert (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_replace (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_find (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_delete (struct rhash *, struct hash_elem *);
+
+/* Iteration. */
+void rhash_apply (struct rhash *, hash_action_func *);
+void rhash_first (struct rhash_iterator *, struct rhash *);
+struct hash_elem *rhash_next (struct rhash_iterator *);
+struct hash_elem *rhash_cur (struct rhash_iterator *);
+
+/* Information. */
+size_t rhash_size (struct rhash *);
+bool rhash_empty (struct rhash *);
+
+#endif /* lib/kernel/rhash.h */
@@ -1,5 +1,34 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The memory functions below work a 32-bit word at a time, using
+   the x86 string instructions for bulk copies and fills.  Below
+   SMALL bytes the setup is not worth it, so they fall back to
+   byte loops.  x86 allows unaligned word accesses, but they are
+   slower, so bulk copies and fills first align the destination.
+
+   strlen() and memchr() test four bytes at once for a zero byte
+   with the usual trick: (W - 0x01010101) & ~W & 0x80808080 is
+   nonzero if and only if some byte of W is zero.  They only read
+   aligned words, which never cross into the next page, so they
+   cannot fault by reading past the end of the string.
+
+   The kernel and user programs both enter every interrupt and
+   system call with the direction flag clear, so memmove() may
+   set it briefly for a backward copy. */
+
+/* Below this many bytes, just use byte loops. */
+#define SMALL 16
+
+/* A word that may alias any other type. */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+/* A word with every byte set to 0x01. */
+#define ONES 0x01010101u
+
+/* True if some byte of word W is zero. */
+#define HAS_ZERO(W) ((((W) - ONES) & ~(W) & (ONES << 7)) != 0)
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +41,21 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= SMALL)
+    {
+      size_t words;
+
+      while ((uintptr_t) dst % sizeof (word_t) != 0)
+        {
+          *dst++ = *src++;
+          size--;
+        }
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+    }
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +73,35 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
+  /* A forward copy is fine unless DST starts inside SRC. */
+  if (dst <= src || dst >= src + size)
+    return memcpy (dst_, src_, size);
+
+  dst += size;
+  src += size;
+  if (size >= SMALL)
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      size_t words;
+
+      while ((uintptr_t) dst % sizeof (word_t) != 0)
+        {
+          *--dst = *--src;
+          size--;
+        }
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      dst -= sizeof (word_t);
+      src -= sizeof (word_t);
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+      dst += sizeof (word_t);
+      src += sizeof (word_t);
     }
+  while (size-- > 0)
+    *--dst = *--src;
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +117,14 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte. */
+  for (; size >= sizeof (word_t); size -= sizeof (word_t))
+    {
+      if (*(const word_t *) a != *(const word_t *) b)
+        break;
+      a += sizeof (word_t);
+      b += sizeof (word_t);
+    }
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -98,6 +165,23 @@ memchr (const void *block_, int ch_, size_t size)
 
   ASSERT (block != NULL || size == 0);
 
+  if (size >= SMALL)
+    {
+      uint32_t pattern = ch * ONES;
+
+      for (; (uintptr_t) block % sizeof (word_t) != 0; block++, size--)
+        if (*block == ch)
+          return (void *) block;
+
+      /* Skip words that do not contain CH. */
+      for (; size >= sizeof (word_t); block += sizeof (word_t),
+                                      size -= sizeof (word_t))
+        {
+          uint32_t w = *(const word_t *) block ^ pattern;
+          if (HAS_ZERO (w))
+            break;
+        }
+    }
   for (; size-- > 0; block++)
     if (*block == ch)
       return (void *) block;
@@ -281,7 +365,24 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= SMALL)
+    {
+      uint32_t pattern = (unsigned char) value * ONES;
+      size_t words;
+
+      while ((uintptr_t) dst % sizeof (word_t) != 0)
+        {
+          *dst++ = value;
+          size--;
+        }
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (pattern)
+                    : "memory");
+    }
   while (size-- > 0)
     *dst++ = value;
 
@@ -296,7 +397,14 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  /* Check bytes up to a word boundary, then whole words, then
+     the bytes of the word that holds the terminator. */
+  for (p = string; (uintptr_t) p % sizeof (word_t) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!HAS_ZERO (*(const word_t *) p))
+    p += sizeof (word_t);
+  for (; *p != '\0'; p++)
     continue;
   return p - string;
 }
@@ -0,0 +1,59 @@
+/* Throughput benchmark for large read and write system calls.
+   Writes a 512 kB file several times over in 64 kB write()
+   calls, then reads it back in 64 kB read() calls and verifies
+   it.  Compare the "Timer" and block device statistics printed
+   at shutdown to measure throughput. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE (64 * 1024)
+#define CHUNK_CNT 8
+#define PASS_CNT 4
+
+/* Page-aligned, so that each page of a chunk covers whole
+   sectors and can take the direct path. */
+static char wbuf[CHUNK_SIZE] __attribute__ ((aligned (4096)));
+static char rbuf[CHUNK_SIZE] __attribute__ ((aligned (4096)));
+
+void
+test_main (void)
+{
+  const char *file_name = "bench";
+  int pass, i, fd;
+
+  random_bytes (wbuf, sizeof wbuf);
+  CHECK (create (file_name, CHUNK_SIZE * CHUNK_CNT), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("write %d passes of %d kB", PASS_CNT, CHUNK_SIZE * CHUNK_CNT / 1024);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      seek (fd, 0);
+      for (i = 0; i < CHUNK_CNT; i++)
+        if (write (fd, wbuf, CHUNK_SIZE) != CHUNK_SIZE)
+          fail ("write %d bytes at offset %d failed", CHUNK_SIZE,
+                i * CHUNK_SIZE);
+    }
+
+  msg ("read %d passes of %d kB", PASS_CNT, CHUNK_SIZE * CHUNK_CNT / 1024);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      seek (fd, 0);
+      for (i = 0; i < CHUNK_CNT; i++)
+        {
+          if (read (fd, rbuf, CHUNK_SIZE) != CHUNK_SIZE)
+            fail ("read %d bytes at offset %d failed", CHUNK_SIZE,
+                  i * CHUNK_SIZE);
+          if (memcmp (rbuf, wbuf, CHUNK_SIZE))
+            fail ("data read at offset %d differs from data written",
+                  i * CHUNK_SIZE);
+        }
+    }
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
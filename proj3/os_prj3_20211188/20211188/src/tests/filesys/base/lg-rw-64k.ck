@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-rw-64k) begin
+(lg-rw-64k) create "bench"
+(lg-rw-64k) open "bench"
+(lg-rw-64k) write 4 passes of 512 kB
+(lg-rw-64k) read 4 passes of 512 kB
+(lg-rw-64k) close "bench"
+(lg-rw-64k) end
+EOF
+pass;
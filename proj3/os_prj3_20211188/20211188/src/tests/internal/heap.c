@@ -0,0 +1,196 @@
+/* Test program for lib/kernel/heap.c.
+
+   Attempts to test the heap functionality that is not
+   sufficiently tested elsewhere in Pintos.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 64
+
+/* A heap element. */
+struct value 
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+    bool in_heap;               /* Currently in the heap? */
+  };
+
+static void shuffle (struct value[], size_t);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static void verify_pops (struct heap *, int size);
+
+/* Test the heap implementation. */
+void
+test (void) 
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++) 
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++) 
+        {
+          static struct value values[MAX_SIZE];
+          struct value *order[MAX_SIZE];
+          struct heap heap;
+          int i, cnt;
+
+          /* Put values 0...SIZE in random order in VALUES. */
+          for (i = 0; i < size; i++)
+            values[i].value = i;
+          shuffle (values, size);
+
+          /* Push them all, and verify that they pop in order. */
+          heap_init (&heap, value_less, NULL);
+          ASSERT (heap_empty (&heap));
+          for (i = 0; i < size; i++)
+            heap_push (&heap, &values[i].elem);
+          ASSERT (heap_size (&heap) == (size_t) size);
+          verify_pops (&heap, size);
+
+          /* Push them again, pop half, push those back, and
+             verify. */
+          shuffle (values, size);
+          for (i = 0; i < size; i++)
+            heap_push (&heap, &values[i].elem);
+          for (i = 0; i < size / 2; i++)
+            ASSERT (heap_entry (heap_pop (&heap), struct value, elem)->value
+                    == i);
+          for (i = 0; i < size; i++)
+            if (values[i].value < size / 2)
+              heap_push (&heap, &values[i].elem);
+          verify_pops (&heap, size);
+
+          /* Push them again, pop one so that the heap has some
+             structure, then remove each element whose value is
+             odd, from wherever it is, and put it back with its
+             value lowered by SIZE, using heap_decrease() for
+             half of them and heap_remove() and heap_push() for
+             the others.  All of them should then come out first,
+             in order. */
+          shuffle (values, size);
+          for (i = 0; i < size; i++)
+            {
+              values[i].in_heap = true;
+              heap_push (&heap, &values[i].elem);
+            }
+          if (size > 0)
+            {
+              struct value *v = heap_entry (heap_pop (&heap), struct value,
+                                            elem);
+              ASSERT (v->value == 0);
+              v->in_heap = false;
+            }
+          cnt = 0;
+          for (i = 0; i < size; i++)
+            if (values[i].in_heap && values[i].value % 2 == 1)
+              {
+                values[i].value -= size;
+                if (cnt++ % 2 == 0)
+                  heap_decrease (&heap, &values[i].elem);
+                else
+                  {
+                    heap_remove (&heap, &values[i].elem);
+                    heap_push (&heap, &values[i].elem);
+                  }
+              }
+          ASSERT (heap_size (&heap) == (size_t) (size > 0 ? size - 1 : 0));
+          {
+            int prev = -MAX_SIZE * 2;
+            while (!heap_empty (&heap))
+              {
+                struct value *v = heap_entry (heap_pop (&heap),
+                                              struct value, elem);
+                ASSERT (v->value >= prev);
+                prev = v->value;
+              }
+          }
+
+          /* Push them again, then remove them all in random
+             order.  (Shuffling VALUES itself would move the
+             elements while they are in the heap.) */
+          for (i = 0; i < size; i++)
+            {
+              order[i] = &values[i];
+              heap_push (&heap, &values[i].elem);
+            }
+          for (i = 0; i < size; i++)
+            {
+              int j = i + random_ulong () % (size - i);
+              struct value *t = order[j];
+              order[j] = order[i];
+              order[i] = t;
+            }
+          for (i = 0; i < size; i++)
+            {
+              heap_remove (&heap, &order[i]->elem);
+              ASSERT (heap_size (&heap) == (size_t) (size - i - 1));
+            }
+          ASSERT (heap_empty (&heap));
+        }
+    }
+
+  printf (" done\n");
+  printf ("heap: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+  
+  return a->value < b->value;
+}
+
+/* Verifies that HEAP pops the values 0...SIZE in order, and is
+   then empty. */
+static void
+verify_pops (struct heap *heap, int size) 
+{
+  int i;
+
+  for (i = 0; i < size; i++) 
+    {
+      struct value *v;
+
+      ASSERT (!heap_empty (heap));
+      ASSERT (heap_size (heap) == (size_t) (size - i));
+      v = heap_entry (heap_front (heap), struct value, elem);
+      ASSERT (v->value == i);
+      ASSERT (heap_pop (heap) == &v->elem);
+    }
+  ASSERT (heap_empty (heap));
+}
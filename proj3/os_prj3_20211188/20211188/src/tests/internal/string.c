@@ -0,0 +1,293 @@
+/* Test program and micro-benchmark for the memory and string
+   functions in lib/string.c.
+
+   First checks memcpy(), memmove(), memset(), memcmp(), memchr(),
+   and strlen() against simple byte-at-a-time versions, at every
+   combination of small sizes and alignments.  Then times each of
+   them, and the byte-at-a-time versions for comparison, on
+   blocks from 16 bytes to 64 kB, and prints bytes per cycle.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block size checked for correctness. */
+#define CHECK_SIZE 80
+
+/* Largest block size benchmarked. */
+#define BENCH_SIZE (64 * 1024)
+
+/* Bytes processed per benchmark, for each size. */
+#define BENCH_BYTES (1024 * 1024)
+
+static uint8_t buf_a[BENCH_SIZE + 64];
+static uint8_t buf_b[BENCH_SIZE + 64];
+static uint8_t buf_c[BENCH_SIZE + 64];
+
+static void check (void);
+static void bench (void);
+
+/* Test memory and string functions. */
+void
+test (void) 
+{
+  check ();
+  bench ();
+  printf ("string: PASS\n");
+}
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Byte-at-a-time reference implementations.  They are volatile
+   so that the compiler does not turn them back into calls to the
+   functions under test. */
+
+static void
+ref_memmove (void *dst_, const void *src_, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+  const volatile uint8_t *src = src_;
+
+  if (dst < src)
+    while (size-- > 0)
+      *dst++ = *src++;
+  else
+    while (size-- > 0)
+      dst[size] = src[size];
+}
+
+static void
+ref_memset (void *dst_, int value, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+static int
+ref_memcmp (const void *a_, const void *b_, size_t size) 
+{
+  const volatile uint8_t *a = a_, *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static void *
+ref_memchr (const void *block_, int ch, size_t size) 
+{
+  const volatile uint8_t *block = block_;
+
+  for (; size-- > 0; block++)
+    if (*block == (uint8_t) ch)
+      return (void *) block;
+  return NULL;
+}
+
+static size_t
+ref_strlen (const char *string) 
+{
+  const volatile char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+/* Returns the sign of X. */
+static int
+sign (int x) 
+{
+  return (x > 0) - (x < 0);
+}
+
+/* Fills buf_a with random bytes and copies it to buf_b and
+   buf_c. */
+static void
+randomize (void) 
+{
+  random_bytes (buf_a, CHECK_SIZE * 3);
+  ref_memmove (buf_b, buf_a, CHECK_SIZE * 3);
+  ref_memmove (buf_c, buf_a, CHECK_SIZE * 3);
+}
+
+/* Checks each function against its reference implementation. */
+static void
+check (void) 
+{
+  size_t size, dst_ofs, src_ofs;
+
+  printf ("checking sizes up to %d:", CHECK_SIZE);
+  for (size = 0; size <= CHECK_SIZE; size++)
+    {
+      for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+        for (src_ofs = 0; src_ofs < 8; src_ofs++)
+          {
+            uint8_t *dst_b = buf_b + CHECK_SIZE + dst_ofs;
+            uint8_t *dst_c = buf_c + CHECK_SIZE + dst_ofs;
+            size_t i;
+            int ch;
+
+            /* memcpy(), into a separate buffer. */
+            randomize ();
+            ASSERT (memcpy (dst_b, buf_a + src_ofs, size) == dst_b);
+            ref_memmove (dst_c, buf_a + src_ofs, size);
+            ASSERT (ref_memcmp (buf_b, buf_c, CHECK_SIZE * 3) == 0);
+
+            /* memmove(), both ways within one buffer. */
+            randomize ();
+            ASSERT (memmove (dst_b, dst_b + src_ofs - 4, size) == dst_b);
+            ref_memmove (dst_c, dst_c + src_ofs - 4, size);
+            ASSERT (ref_memcmp (buf_b, buf_c, CHECK_SIZE * 3) == 0);
+
+            /* memset(). */
+            ch = random_ulong ();
+            ASSERT (memset (dst_b, ch, size) == dst_b);
+            ref_memset (dst_c, ch, size);
+            ASSERT (ref_memcmp (buf_b, buf_c, CHECK_SIZE * 3) == 0);
+
+            /* memcmp(), equal and with one bit flipped. */
+            randomize ();
+            ASSERT (memcmp (dst_b, dst_c, size) == 0);
+            if (size > 0)
+              dst_c[random_ulong () % size] ^= 1 << random_ulong () % 8;
+            ASSERT (sign (memcmp (dst_b, dst_c, size))
+                    == ref_memcmp (dst_b, dst_c, size));
+
+            /* memchr(), for a byte that may or may not be there. */
+            ch = buf_a[random_ulong () % (CHECK_SIZE * 2)];
+            ASSERT (memchr (dst_b, ch, size) == ref_memchr (dst_b, ch, size));
+
+            /* strlen(). */
+            for (i = 0; i < size; i++)
+              if (dst_b[i] == '\0')
+                dst_b[i] = 1;
+            dst_b[size] = '\0';
+            ASSERT (strlen ((char *) dst_b) == size);
+          }
+      if (size % 16 == 0)
+        printf (" %zu", size);
+    }
+  printf (" done\n");
+}
+
+/* Prints BYTES bytes in CYCLES cycles as bytes per cycle, to two
+   decimal places. */
+static void
+print_rate (const char *name, size_t bytes, uint64_t cycles) 
+{
+  unsigned hundredths = cycles > 0 ? bytes * 100ULL / cycles : 0;
+
+  printf (" %s %u.%02u", name, hundredths / 100, hundredths % 100);
+}
+
+/* Times the optimized and reference version of each function on
+   each block size, and prints bytes per cycle. */
+static void
+bench (void) 
+{
+  size_t size;
+
+  printf ("bytes per cycle, optimized/byte loop:\n");
+  for (size = 16; size <= BENCH_SIZE; size *= 4)
+    {
+      size_t reps = BENCH_BYTES / size;
+      size_t bytes = reps * size;
+      uint64_t start, fast, slow;
+      size_t i;
+
+      /* Blocks that are not all zero and do not contain a zero,
+         so that every function sees the whole block. */
+      ref_memset (buf_a, 'a', size + 1);
+      ref_memset (buf_b, 'a', size + 1);
+      buf_a[size] = buf_b[size] = '\0';
+
+      printf ("%6zu:", size);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        memcpy (buf_c, buf_a, size);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ref_memmove (buf_c, buf_a, size);
+      slow = rdtsc () - start;
+      print_rate ("memcpy", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        memmove (buf_c + 1, buf_c, size);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ref_memmove (buf_c + 1, buf_c, size);
+      slow = rdtsc () - start;
+      print_rate ("memmove", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        memset (buf_c, 0, size);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ref_memset (buf_c, 0, size);
+      slow = rdtsc () - start;
+      print_rate ("memset", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (memcmp (buf_a, buf_b, size) == 0);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (ref_memcmp (buf_a, buf_b, size) == 0);
+      slow = rdtsc () - start;
+      print_rate ("memcmp", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (memchr (buf_a, 'b', size) == NULL);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (ref_memchr (buf_a, 'b', size) == NULL);
+      slow = rdtsc () - start;
+      print_rate ("memchr", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (strlen ((char *) buf_a) == size);
+      fast = rdtsc () - start;
+      start = rdtsc ();
+      for (i = 0; i < reps; i++)
+        ASSERT (ref_strlen ((char *) buf_a) == size);
+      slow = rdtsc () - start;
+      print_rate ("strlen", bytes, fast);
+      print_rate ("/", bytes, slow);
+
+      printf ("\n");
+    }
+}
@@ -0,0 +1,84 @@
+/* Sleeps for various sub-tick durations with timer_usleep() and
+   checks, against timer_now_ns(), that each sleep lasts at least
+   as long as asked and that no sleep overshoots by a whole timer
+   tick, as a sleep rounded up to the next tick would.  The
+   median overshoot is reported but not checked, since it depends
+   on how fast the machine or emulator is.  A lower-priority thread counts while we
+   sleep, to make sure the sleeps give up the CPU instead of
+   busy-waiting. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of a timer tick, in microseconds.  No sleep may
+   overshoot by this much. */
+#define TICK_US (1000 * 1000 / TIMER_FREQ)
+
+/* Times to sleep each duration. */
+#define ITERATIONS 10
+
+static thread_func counter;
+static volatile bool done;
+static volatile int64_t count;
+static struct semaphore counter_done;
+
+void
+test_alarm_usleep (void) 
+{
+  static const int64_t durations[] = {100, 200, 500, 1000, 5000};
+  size_t i;
+  int j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&counter_done, 0);
+  thread_create ("counter", PRI_DEFAULT - 1, counter, NULL);
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++)
+    {
+      int64_t us = durations[i];
+      int64_t over[ITERATIONS];
+
+      for (j = 0; j < ITERATIONS; j++)
+        {
+          int64_t start = timer_now_ns ();
+          int64_t slept;
+          int k;
+
+          timer_usleep (us);
+          slept = (timer_now_ns () - start) / 1000;
+          if (slept < us)
+            fail ("slept %lld us, asked for %lld us", slept, us);
+          if (slept - us >= TICK_US)
+            fail ("sleeping %lld us overshot by %lld us, a whole tick",
+                  us, slept - us);
+
+          /* Insert into OVER, keeping it sorted. */
+          for (k = j; k > 0 && over[k - 1] > slept - us; k--)
+            over[k] = over[k - 1];
+          over[k] = slept - us;
+        }
+      msg ("%lld us sleeps ok, median overshoot %lld us",
+           us, over[ITERATIONS / 2]);
+    }
+
+  done = true;
+  sema_down (&counter_done);
+  if (count == 0)
+    fail ("counter never ran while we slept");
+  msg ("counter ran while we slept");
+}
+
+/* Counts until the test is done. */
+static void
+counter (void *aux UNUSED) 
+{
+  while (!done)
+    count++;
+  sema_up (&counter_done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+s/overshoot \d+ us/overshoot N us/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) 100 us sleeps ok, median overshoot N us
+(alarm-usleep) 200 us sleeps ok, median overshoot N us
+(alarm-usleep) 500 us sleeps ok, median overshoot N us
+(alarm-usleep) 1000 us sleeps ok, median overshoot N us
+(alarm-usleep) 5000 us sleeps ok, median overshoot N us
+(alarm-usleep) counter ran while we slept
+(alarm-usleep) end
+EOF
+pass;
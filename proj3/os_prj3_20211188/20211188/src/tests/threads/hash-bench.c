@@ -0,0 +1,186 @@
+/* Benchmarks the open-addressing hash table in rhash.h against
+   the chained one in hash.h.
+
+   For each table, we insert ELEM_CNT elements, look each of them
+   up, look up as many keys that are not there, and delete them
+   all again, reporting the average time of each operation.  We
+   also report the slowest single insertion, which is where the
+   chained table pays for rehashing everything at once.
+
+   Timings are only reported.  What is checked is the number of
+   elements each insertion moves from one array of buckets or
+   slots to another: the chained table moves them all at once,
+   but the open table must never move more than MIGRATE_MAX. */
+
+#include <hash.h>
+#include <rhash.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+#define ELEM_CNT 4096
+
+/* Most elements one rhash operation may move while resizing:
+   MIGRATE_SLOTS in rhash.c. */
+#define MIGRATE_MAX 8
+
+/* An element in both kinds of table. */
+struct item
+  {
+    int key;
+    struct hash_elem elem;
+  };
+
+static struct item items[ELEM_CNT];
+
+/* The two tables. */
+static struct hash chained;
+static struct rhash open;
+
+static hash_hash_func item_hash;
+static hash_less_func item_less;
+static size_t run (bool use_open);
+static size_t moved_cnt (bool use_open, size_t before);
+static size_t in_transit (bool use_open);
+
+/* Operations on the chained table, or the open one if USE_OPEN
+   is true. */
+#define INSERT(E) \
+        (use_open ? rhash_insert (&open, E) : hash_insert (&chained, E))
+#define FIND(E) \
+        (use_open ? rhash_find (&open, E) : hash_find (&chained, E))
+#define DELETE(E) \
+        (use_open ? rhash_delete (&open, E) : hash_delete (&chained, E))
+
+void
+test_hash_bench (void) 
+{
+  size_t chained_moved, open_moved;
+  int i;
+
+  /* Spread the keys out, so that they do not hash in order. */
+  for (i = 0; i < ELEM_CNT; i++)
+    items[i].key = i * 7919;
+
+  if (!hash_init (&chained, item_hash, item_less, NULL)
+      || !rhash_init (&open, item_hash, item_less, NULL))
+    fail ("out of memory");
+  chained_moved = run (false);
+  open_moved = run (true);
+  hash_destroy (&chained, NULL);
+  rhash_destroy (&open, NULL);
+
+  if (chained_moved < ELEM_CNT / 2)
+    fail ("chained table moved at most %zu elements in one insert",
+          chained_moved);
+  if (open_moved == 0)
+    fail ("open table never resized");
+  if (open_moved > MIGRATE_MAX)
+    fail ("open table moved %zu elements in one insert", open_moved);
+  msg ("no open table insert moved more than %d elements", MIGRATE_MAX);
+}
+
+/* Runs the benchmark on the chained table, or the open one if
+   USE_OPEN is true, and returns the most elements that a single
+   insertion moved. */
+static size_t
+run (bool use_open) 
+{
+  const char *name = use_open ? "open" : "chained";
+  int64_t start, t, worst = 0;
+  int64_t insert_ns, find_ns, miss_ns, delete_ns;
+  size_t most_moved = 0;
+  struct item probe;
+  int i;
+
+  start = timer_now_ns ();
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      size_t before = in_transit (use_open);
+      size_t moved;
+
+      t = timer_now_ns ();
+      if (INSERT (&items[i].elem) != NULL)
+        fail ("%s: key %d inserted twice", name, items[i].key);
+      t = timer_now_ns () - t;
+      if (t > worst)
+        worst = t;
+
+      moved = moved_cnt (use_open, before);
+      if (moved > most_moved)
+        most_moved = moved;
+    }
+  insert_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  for (i = 0; i < ELEM_CNT; i++)
+    if (FIND (&items[i].elem) != &items[i].elem)
+      fail ("%s: key %d not found", name, items[i].key);
+  find_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      probe.key = i * 7919 + 1;
+      if (FIND (&probe.elem) != NULL)
+        fail ("%s: key %d found", name, probe.key);
+    }
+  miss_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  for (i = 0; i < ELEM_CNT; i++)
+    if (DELETE (&items[i].elem) != &items[i].elem)
+      fail ("%s: key %d not deleted", name, items[i].key);
+  delete_ns = timer_now_ns () - start;
+
+  msg ("%s: insert %lld ns, find %lld ns, miss %lld ns, delete %lld ns",
+       name, insert_ns / ELEM_CNT, find_ns / ELEM_CNT,
+       miss_ns / ELEM_CNT, delete_ns / ELEM_CNT);
+  msg ("%s: slowest insert %lld ns", name, worst);
+  return most_moved;
+}
+
+/* For the open table, returns the number of elements still
+   waiting to be moved out of its old array.  For the chained
+   table, returns its number of buckets. */
+static size_t
+in_transit (bool use_open)
+{
+  return use_open ? (open.old.slots != NULL ? open.old_cnt : 0)
+                  : chained.bucket_cnt;
+}
+
+/* Returns the number of elements that the last insertion moved,
+   given BEFORE, the value of in_transit() just before it. */
+static size_t
+moved_cnt (bool use_open, size_t before)
+{
+  size_t after = in_transit (use_open);
+
+  if (!use_open)
+    {
+      /* Rehashing moves every element, the new one included. */
+      return after != before ? chained.elem_cnt : 0;
+    }
+
+  /* A resize can only start once the old array is empty, so if
+     more elements are waiting now, all that were are gone. */
+  return after <= before ? before - after : before;
+}
+
+/* Hashes an item's key. */
+static unsigned
+item_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct item, elem)->key);
+}
+
+/* Orders items by key. */
+static bool
+item_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED) 
+{
+  return (hash_entry (a, struct item, elem)->key
+          < hash_entry (b, struct item, elem)->key);
+}
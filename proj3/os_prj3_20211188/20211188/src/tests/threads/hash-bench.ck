@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+s/\d+ ns/N ns/g foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(hash-bench) begin
+(hash-bench) chained: insert N ns, find N ns, miss N ns, delete N ns
+(hash-bench) chained: slowest insert N ns
+(hash-bench) open: insert N ns, find N ns, miss N ns, delete N ns
+(hash-bench) open: slowest insert N ns
+(hash-bench) no open table insert moved more than 8 elements
+(hash-bench) end
+EOF
+pass;
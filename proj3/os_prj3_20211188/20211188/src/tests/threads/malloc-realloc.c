@@ -0,0 +1,110 @@
+/* Checks that realloc() resizes blocks in place when it can, and
+   that blocks just over 1 kB share pages.
+
+   A normal block must stay put while the new size still fits in
+   its size class.  A big block must stay put when shrinking, and
+   when growing into pages that we have made sure are free: we
+   take a run of pages, give back all but the first, and hand that
+   to palloc_extend() directly.  The single-page caches are turned
+   off so that the pages we free really go back to the pool. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+static void fill (uint8_t *, size_t size, uint8_t seed);
+static void check (const uint8_t *, size_t size, uint8_t seed);
+
+void
+test_malloc_realloc (void) 
+{
+  uint8_t *p, *q, *r;
+
+  palloc_set_caching (false);
+
+  /* Normal blocks. */
+  p = malloc (40);
+  fill (p, 40, 1);
+  q = realloc (p, 64);
+  if (q != p)
+    fail ("40-byte block moved when grown to 64 bytes");
+  q = realloc (q, 20);
+  if (q != p)
+    fail ("64-byte block moved when shrunk to 20 bytes");
+  check (q, 20, 1);
+  q = realloc (q, 100);
+  check (q, 20, 1);
+  free (q);
+  msg ("normal blocks resized in place");
+
+  /* Blocks just too big for 1 kB share a page. */
+  p = malloc (1100);
+  q = malloc (1100);
+  r = malloc (1100);
+  if (pg_round_down (p) != pg_round_down (q)
+      || pg_round_down (q) != pg_round_down (r))
+    fail ("1100-byte blocks not packed three to a page");
+  free (p);
+  free (q);
+  free (r);
+  p = malloc (2000);
+  q = malloc (2000);
+  if (pg_round_down (p) != pg_round_down (q))
+    fail ("2000-byte blocks not packed two to a page");
+  free (p);
+  free (q);
+  msg ("intermediate size classes packed");
+
+  /* Big blocks. */
+  p = malloc (3 * PGSIZE);
+  fill (p, 3 * PGSIZE, 2);
+  q = realloc (p, PGSIZE + 100);
+  if (q != p)
+    fail ("big block moved when shrunk");
+  check (q, PGSIZE + 100, 2);
+  free (q);
+  msg ("big block shrunk in place");
+
+  p = palloc_get_multiple (0, 8);
+  if (p == NULL)
+    fail ("palloc_get_multiple failed");
+  palloc_free_multiple (p + 2 * PGSIZE, 6);
+  if (!palloc_extend (p, 2, 8))
+    fail ("palloc_extend failed over free pages");
+  if (palloc_extend (p, 1, 2))
+    fail ("palloc_extend succeeded over used pages");
+  palloc_free_multiple (p, 8);
+  msg ("pages extended in place");
+
+  palloc_set_caching (true);
+}
+
+/* Fills the SIZE bytes at P with a pattern based on SEED. */
+static void
+fill (uint8_t *p, size_t size, uint8_t seed) 
+{
+  size_t i;
+
+  if (p == NULL)
+    fail ("out of memory");
+  for (i = 0; i < size; i++)
+    p[i] = seed + i * 7;
+}
+
+/* Checks that the SIZE bytes at P still hold the pattern that
+   fill() wrote with SEED. */
+static void
+check (const uint8_t *p, size_t size, uint8_t seed) 
+{
+  size_t i;
+
+  if (p == NULL)
+    fail ("out of memory");
+  for (i = 0; i < size; i++)
+    if (p[i] != (uint8_t) (seed + i * 7))
+      fail ("byte %zu changed", i);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) normal blocks resized in place
+(malloc-realloc) intermediate size classes packed
+(malloc-realloc) big block shrunk in place
+(malloc-realloc) pages extended in place
+(malloc-realloc) end
+EOF
+pass;
@@ -0,0 +1,141 @@
+/* Exercises the buddy page allocator on the user pool, which the
+   threads tests otherwise leave alone.  Checks that blocks never
+   overlap, and that once everything is freed again the pool has
+   coalesced back into its largest block.  The single-page caches
+   are turned off, so that every page really goes back. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 64            /* Blocks live at once in stress test. */
+#define ROUNDS 2000             /* Stress test rounds. */
+
+struct block
+  {
+    uint32_t *pages;            /* Pages, or null. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static void tag_block (struct block *, uint32_t tag);
+static void check_block (const struct block *, uint32_t tag);
+
+void
+test_palloc_buddy (void) 
+{
+  static struct block blocks[BLOCK_CNT];
+  void *head = NULL;
+  size_t page_cnt = 0, largest, i;
+  void *big;
+
+  palloc_set_caching (false);
+
+  /* Take every page, chaining them together through their first
+     word, then free them in an order that fragments the pool as
+     much as possible: every other page first. */
+  for (;;)
+    {
+      void **page = palloc_get_page (PAL_USER);
+      if (page == NULL)
+        break;
+      *page = head;
+      head = page;
+      page_cnt++;
+    }
+  msg ("allocated every page");
+  for (i = 0; i < 2; i++)
+    {
+      void **prev = NULL, **page = head;
+      size_t j;
+
+      for (j = 0; page != NULL; j++)
+        {
+          void **next = *page;
+          if (j % 2 == i)
+            {
+              if (prev != NULL)
+                *prev = next;
+              else
+                head = next;
+              palloc_free_page (page);
+            }
+          else
+            prev = page;
+          page = next;
+        }
+    }
+  if (head != NULL)
+    fail ("pages left over after freeing all of them");
+  msg ("freed every page");
+
+  /* The largest power of two no larger than the pool is one
+     block again. */
+  for (largest = 1; largest * 2 <= page_cnt; largest *= 2)
+    continue;
+  big = palloc_get_multiple (PAL_USER, largest);
+  if (big == NULL)
+    fail ("could not allocate %zu of %zu pages at once", largest, page_cnt);
+  palloc_free_multiple (big, largest);
+  msg ("largest block is whole again");
+
+  /* Random sizes, including ones that are not powers of two. */
+  random_init (0);
+  for (i = 0; i < ROUNDS; i++)
+    {
+      struct block *b = &blocks[random_ulong () % BLOCK_CNT];
+      uint32_t tag = b - blocks;
+
+      if (b->pages != NULL)
+        {
+          check_block (b, tag);
+          palloc_free_multiple (b->pages, b->page_cnt);
+          b->pages = NULL;
+        }
+      else
+        {
+          b->page_cnt = random_ulong () % 16 + 1;
+          b->pages = palloc_get_multiple (PAL_USER, b->page_cnt);
+          if (b->pages != NULL)
+            tag_block (b, tag);
+        }
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (blocks[i].pages != NULL)
+      {
+        check_block (&blocks[i], i);
+        palloc_free_multiple (blocks[i].pages, blocks[i].page_cnt);
+      }
+  msg ("random blocks did not overlap");
+
+  big = palloc_get_multiple (PAL_USER, largest);
+  if (big == NULL)
+    fail ("pool did not coalesce after random test");
+  palloc_free_multiple (big, largest);
+  msg ("largest block is whole again");
+
+  palloc_set_caching (true);
+}
+
+/* Fills every page of B with TAG. */
+static void
+tag_block (struct block *b, uint32_t tag)
+{
+  size_t i;
+
+  for (i = 0; i < b->page_cnt * PGSIZE / sizeof *b->pages; i++)
+    b->pages[i] = tag;
+}
+
+/* Checks that every page of B still holds TAG. */
+static void
+check_block (const struct block *b, uint32_t tag)
+{
+  size_t i;
+
+  for (i = 0; i < b->page_cnt * PGSIZE / sizeof *b->pages; i++)
+    if (b->pages[i] != tag)
+      fail ("block %"PRIu32" was overwritten", tag);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) allocated every page
+(palloc-buddy) freed every page
+(palloc-buddy) largest block is whole again
+(palloc-buddy) random blocks did not overlap
+(palloc-buddy) largest block is whole again
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,95 @@
+/* Benchmarks the page allocator under exec/exit churn.
+
+   Each cycle creates a thread that allocates and frees pages the
+   way a short-lived process does: a page directory and page
+   tables from the kernel pool, zeroed and not, stack and data
+   pages from the user pool, and then exits.  The parent waits for
+   it, then sleeps briefly, as if reading the next executable,
+   which leaves the CPU idle for background page zeroing.  We
+   report the average time per cycle, not counting the sleep,
+   with the single-page caches off and on.  Timings vary too much
+   from run to run to check, so they are only reported. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define CYCLES 300              /* Process lifetimes per run. */
+#define KERNEL_PAGES 3          /* Page directory and tables. */
+#define USER_PAGES 8            /* Code, data, and stack. */
+
+static thread_func process;
+static int64_t run (bool caching);
+
+void
+test_palloc_churn (void) 
+{
+  int64_t off, on;
+
+  off = run (false);
+  on = run (true);
+  msg ("caches off: %lld us per cycle", off / 1000);
+  msg ("caches on: %lld us per cycle", on / 1000);
+}
+
+/* Runs CYCLES cycles with the page caches turned on or off,
+   according to CACHING, and returns the average time per cycle
+   in nanoseconds. */
+static int64_t
+run (bool caching) 
+{
+  struct semaphore done;
+  int64_t total = 0;
+  int i;
+
+  palloc_set_caching (caching);
+  sema_init (&done, 0);
+  for (i = 0; i < CYCLES; i++)
+    {
+      int64_t start = timer_now_ns ();
+
+      if (thread_create ("process", PRI_DEFAULT, process, &done)
+          == TID_ERROR)
+        fail ("thread_create failed");
+      sema_down (&done);
+      total += timer_now_ns () - start;
+
+      timer_usleep (200);
+    }
+  palloc_set_caching (true);
+
+  return total / CYCLES;
+}
+
+/* A short-lived "process". */
+static void
+process (void *done_) 
+{
+  struct semaphore *done = done_;
+  void *kpages[KERNEL_PAGES];
+  void *upages[USER_PAGES];
+  int i;
+
+  for (i = 0; i < KERNEL_PAGES; i++)
+    kpages[i] = palloc_get_page (i == 0 ? 0 : PAL_ZERO);
+  for (i = 0; i < USER_PAGES; i++)
+    upages[i] = palloc_get_page (PAL_USER | (i % 2 ? PAL_ZERO : 0));
+
+  for (i = 0; i < USER_PAGES; i++)
+    {
+      if (upages[i] == NULL)
+        fail ("out of user pages");
+      palloc_free_page (upages[i]);
+    }
+  for (i = 0; i < KERNEL_PAGES; i++)
+    {
+      if (kpages[i] == NULL)
+        fail ("out of kernel pages");
+      palloc_free_page (kpages[i]);
+    }
+  sema_up (done);
+}
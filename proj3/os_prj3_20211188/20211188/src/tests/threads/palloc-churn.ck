@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+s/\d+ us per cycle/N us per cycle/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-churn) begin
+(palloc-churn) caches off: N us per cycle
+(palloc-churn) caches on: N us per cycle
+(palloc-churn) end
+EOF
+pass;
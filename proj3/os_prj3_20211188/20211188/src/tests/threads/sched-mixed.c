@@ -0,0 +1,169 @@
+/* Mixed interactive and batch benchmark.
+
+   BATCH_CNT CPU-bound threads run at a low priority alongside an
+   interactive thread that repeatedly sleeps for one tick.  We
+   measure how late the interactive thread gets back onto the CPU
+   after each wake-up, and how often the batch threads are
+   preempted.  This is done with uniform time slices, with time
+   slices that grow as priority falls, and with the latter plus a
+   latency-sensitive interactive thread.  Longer slices for the
+   low-priority batch threads must preempt them less often per
+   tick than uniform slices do, and the latency-sensitive thread
+   must never be kept waiting for a whole tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define BATCH_CNT 3                     /* Number of batch threads. */
+#define PRI_BATCH (PRI_DEFAULT - 10)    /* Their priority. */
+#define WAKEUPS 30                      /* Interactive wake-ups per run. */
+
+#define NSEC_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+/* A scheduler configuration to measure. */
+struct config
+  {
+    const char *name;
+    int slice_min, slice_max;           /* Time slice bounds. */
+    bool latency_sensitive;             /* Mark interactive thread? */
+  };
+
+/* A batch thread. */
+struct batch
+  {
+    struct run *run;
+    int preemptions;                    /* Times we noticed preemption. */
+  };
+
+/* One run of the benchmark. */
+struct run
+  {
+    const struct config *config;
+    volatile bool stop;                 /* Tells batch threads to stop. */
+    struct batch batches[BATCH_CNT];
+    int64_t worst_ns;                   /* Worst wake-up latency. */
+    int preemptions;                    /* Total batch preemptions. */
+    int64_t ticks;                      /* Length of the run. */
+    struct semaphore done;              /* Upped by each thread. */
+  };
+
+static thread_func batch_thread, interactive_thread;
+static void measure (const struct config *, struct run *);
+
+void
+test_sched_mixed (void) 
+{
+  static const struct config configs[] =
+    {
+      {"uniform slices", 4, 4, false},
+      {"per-priority slices", 2, 16, false},
+      {"latency-sensitive", 2, 16, true},
+    };
+  static struct run runs[sizeof configs / sizeof *configs];
+  int old_min = thread_slice_min;
+  int old_max = thread_slice_max;
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < sizeof configs / sizeof *configs; i++)
+    measure (&configs[i], &runs[i]);
+
+  thread_slice_min = old_min;
+  thread_slice_max = old_max;
+
+  /* Compare preemptions per tick, since runs differ in length. */
+  if (runs[1].preemptions * runs[0].ticks
+      >= runs[0].preemptions * runs[1].ticks)
+    fail ("per-priority slices did not preempt batch threads less often");
+}
+
+/* Runs the benchmark under CONFIG, recording and reporting the
+   results in RUN. */
+static void
+measure (const struct config *config, struct run *run) 
+{
+  int64_t start;
+  int i;
+
+  thread_slice_min = config->slice_min;
+  thread_slice_max = config->slice_max;
+
+  run->config = config;
+  run->stop = false;
+  run->worst_ns = 0;
+  sema_init (&run->done, 0);
+  for (i = 0; i < BATCH_CNT; i++)
+    {
+      char name[16];
+
+      run->batches[i].run = run;
+      run->batches[i].preemptions = 0;
+      snprintf (name, sizeof name, "batch %d", i);
+      thread_create (name, PRI_BATCH, batch_thread, &run->batches[i]);
+    }
+  start = timer_ticks ();
+  thread_create ("interactive", PRI_DEFAULT, interactive_thread, run);
+
+  for (i = 0; i < BATCH_CNT + 1; i++)
+    sema_down (&run->done);
+  run->ticks = timer_ticks () - start;
+
+  run->preemptions = 0;
+  for (i = 0; i < BATCH_CNT; i++)
+    run->preemptions += run->batches[i].preemptions;
+  msg ("%s: worst wake-up latency %lld us, "
+       "%d batch preemptions in %lld ticks",
+       config->name, run->worst_ns / 1000, run->preemptions, run->ticks);
+
+  if (config->latency_sensitive && run->worst_ns >= NSEC_PER_TICK)
+    fail ("latency-sensitive thread waited %lld us to run",
+          run->worst_ns / 1000);
+}
+
+/* Spins until told to stop, counting the times it notices that it
+   was off the CPU for a tick or more. */
+static void
+batch_thread (void *batch_) 
+{
+  struct batch *batch = batch_;
+  int64_t last = timer_ticks ();
+
+  while (!batch->run->stop)
+    {
+      int64_t now = timer_ticks ();
+      if (now - last > 1)
+        batch->preemptions++;
+      last = now;
+    }
+  sema_up (&batch->run->done);
+}
+
+/* Sleeps for a tick WAKEUPS times, measuring how long after the
+   tick it actually gets to run. */
+static void
+interactive_thread (void *run_) 
+{
+  struct run *run = run_;
+  int i;
+
+  thread_set_latency_sensitive (run->config->latency_sensitive);
+  for (i = 0; i < WAKEUPS; i++)
+    {
+      int64_t wake = timer_ticks () + 1;
+      int64_t late;
+
+      timer_sleep (1);
+      late = timer_now_ns () - wake * NSEC_PER_TICK;
+      if (late > run->worst_ns)
+        run->worst_ns = late;
+    }
+
+  run->stop = true;
+  sema_up (&run->done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The test compares the runs itself; here only the wording is
+# checked.
+s/-?\d+ us, \d+ batch preemptions in \d+/N us, N batch preemptions in N/
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(sched-mixed) begin
+(sched-mixed) uniform slices: worst wake-up latency N us, N batch preemptions in N ticks
+(sched-mixed) per-priority slices: worst wake-up latency N us, N batch preemptions in N ticks
+(sched-mixed) latency-sensitive: worst wake-up latency N us, N batch preemptions in N ticks
+(sched-mixed) end
+EOF
+pass;
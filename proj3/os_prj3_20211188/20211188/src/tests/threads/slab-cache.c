@@ -0,0 +1,180 @@
+/* Checks object caches, then benchmarks them against malloc().
+
+   We allocate a good number of inode-sized objects from a cache
+   with a constructor and check that each one comes back aligned,
+   constructed, and not overlapping any other.  We free them with
+   their constructed state intact and check that reallocating
+   them does not run the constructor again on objects that were
+   never released to the page allocator.  Finally we compare the
+   cache with malloc(): the same objects must occupy fewer pages,
+   and we report how long an allocate/free pair takes from each. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define OBJ_CNT 64              /* Objects allocated at once. */
+#define ITERATIONS 20000        /* Allocate/free pairs timed. */
+#define ALIGN 16                /* Object alignment. */
+#define OBJ_MAGIC 0x0b1ec7      /* Set by constructor. */
+
+/* About the size of a struct inode. */
+struct object
+  {
+    unsigned magic;             /* OBJ_MAGIC while constructed. */
+    unsigned serial;            /* Order of construction. */
+    uint8_t data[528];          /* Scribbled on while allocated. */
+  };
+
+static unsigned ctor_cnt;
+
+static kmem_ctor object_ctor;
+static void check_objects (struct object *[]);
+static int count_pages (struct object *[]);
+
+void
+test_slab_cache (void) 
+{
+  struct object *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  unsigned max_serial;
+  int64_t start, slab_ns, malloc_ns;
+  int slab_pages, malloc_pages;
+  int i;
+
+  cache = kmem_cache_create ("test", sizeof (struct object), ALIGN,
+                             object_ctor);
+  if (cache == NULL)
+    fail ("kmem_cache_create failed");
+
+  /* Allocate, check, scribble, restore, and free. */
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("kmem_cache_alloc failed");
+    }
+  check_objects (objs);
+  max_serial = 0;
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      if (objs[i]->serial > max_serial)
+        max_serial = objs[i]->serial;
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      unsigned j;
+      for (j = 0; j < sizeof objs[i]->data; j++)
+        if (objs[i]->data[j] != (uint8_t) i)
+          fail ("object %d overwritten at byte %u", i, j);
+    }
+  for (i = OBJ_CNT - 1; i >= 0; i--)
+    kmem_cache_free (cache, objs[i]);
+  msg ("%d objects allocated and freed", OBJ_CNT);
+
+  /* The first few objects are still cached in the magazine or
+     in slabs that were kept, so they must come back without
+     being constructed again. */
+  objs[0] = kmem_cache_alloc (cache);
+  if (objs[0] == NULL)
+    fail ("kmem_cache_alloc failed");
+  if (objs[0]->magic != OBJ_MAGIC)
+    fail ("reallocated object not in constructed state");
+  if (objs[0]->serial > max_serial)
+    fail ("reallocated object was constructed again");
+  kmem_cache_free (cache, objs[0]);
+  msg ("constructed state preserved");
+
+  /* Compare the pages the objects take up. */
+  for (i = 0; i < OBJ_CNT; i++)
+    objs[i] = kmem_cache_alloc (cache);
+  slab_pages = count_pages (objs);
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    if ((objs[i] = malloc (sizeof (struct object))) == NULL)
+      fail ("malloc failed");
+  malloc_pages = count_pages (objs);
+  for (i = 0; i < OBJ_CNT; i++)
+    free (objs[i]);
+
+  msg ("kmem_cache_alloc: %d objects in %d pages", OBJ_CNT, slab_pages);
+  msg ("malloc: %d objects in %d pages", OBJ_CNT, malloc_pages);
+  if (slab_pages >= malloc_pages)
+    fail ("cache does not pack objects more tightly than malloc");
+
+  /* Time the cache and malloc(). */
+  start = timer_now_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    kmem_cache_free (cache, kmem_cache_alloc (cache));
+  slab_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    free (malloc (sizeof (struct object)));
+  malloc_ns = timer_now_ns () - start;
+
+  msg ("kmem_cache_alloc/free: %lld ns", slab_ns / ITERATIONS);
+  msg ("malloc/free: %lld ns", malloc_ns / ITERATIONS);
+}
+
+/* Constructs object O_. */
+static void
+object_ctor (void *o_) 
+{
+  struct object *o = o_;
+
+  o->magic = OBJ_MAGIC;
+  o->serial = ++ctor_cnt;
+}
+
+/* Checks that each of the OBJ_CNT objects in OBJS is aligned,
+   constructed, and disjoint from the others. */
+static void
+check_objects (struct object *objs[]) 
+{
+  int i, j;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      uintptr_t a = (uintptr_t) objs[i];
+
+      if (a % ALIGN != 0)
+        fail ("object %d at %p is misaligned", i, objs[i]);
+      if (objs[i]->magic != OBJ_MAGIC)
+        fail ("object %d not constructed", i);
+      for (j = 0; j < i; j++)
+        {
+          uintptr_t b = (uintptr_t) objs[j];
+          if (a < b + sizeof (struct object) && b < a + sizeof (struct object))
+            fail ("objects %d and %d overlap", i, j);
+        }
+    }
+}
+
+/* Returns the number of distinct pages that the OBJ_CNT objects in
+   OBJS start on. */
+static int
+count_pages (struct object *objs[]) 
+{
+  int cnt = 0;
+  int i, j;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      for (j = 0; j < i; j++)
+        if (pg_round_down (objs[j]) == pg_round_down (objs[i]))
+          break;
+      if (j == i)
+        cnt++;
+    }
+  return cnt;
+}
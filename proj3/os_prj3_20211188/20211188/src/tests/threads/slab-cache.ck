@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+s/\d+ ns$/N ns/ foreach @output;
+s/in \d+ pages$/in N pages/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(slab-cache) begin
+(slab-cache) 64 objects allocated and freed
+(slab-cache) constructed state preserved
+(slab-cache) kmem_cache_alloc: 64 objects in N pages
+(slab-cache) malloc: 64 objects in N pages
+(slab-cache) kmem_cache_alloc/free: N ns
+(slab-cache) malloc/free: N ns
+(slab-cache) end
+EOF
+pass;
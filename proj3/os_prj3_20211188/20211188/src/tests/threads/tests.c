@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-usleep", test_alarm_usleep},
     {"priority-change", test_priority_change},
     {"priority-change-2", test_priority_change_2},
     {"priority-donate-one", test_priority_donate_one},
@@ -41,6 +42,14 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"workqueue", test_workqueue},
+    {"workqueue-requeue", test_workqueue_requeue},
+    {"sched-mixed", test_sched_mixed},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-churn", test_palloc_churn},
+    {"slab-cache", test_slab_cache},
+    {"malloc-realloc", test_malloc_realloc},
+    {"hash-bench", test_hash_bench},
   };
 
 static const char *test_name;
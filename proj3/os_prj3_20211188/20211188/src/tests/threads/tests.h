@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_usleep;
 extern test_func test_priority_change;
 extern test_func test_priority_change_2;
 extern test_func test_priority_donate_one;
@@ -35,6 +36,14 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_workqueue;
+extern test_func test_workqueue_requeue;
+extern test_func test_sched_mixed;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_churn;
+extern test_func test_slab_cache;
+extern test_func test_malloc_realloc;
+extern test_func test_hash_bench;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,58 @@
+/* Runs a work item that resubmits itself from its own function
+   on a queue with several workers, and checks that it never runs
+   on two of them at once and that work_wait() does not return
+   until its last run is done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/atomic.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define WORKER_CNT 3
+#define RUN_CNT 20
+
+static struct workqueue *wq;
+static struct work work;
+static volatile int32_t running;
+static int max_running;
+static int run_cnt;
+
+static work_func resubmit_work;
+
+void
+test_workqueue_requeue (void) 
+{
+  wq = workqueue_create ("requeue", PRI_DEFAULT, WORKER_CNT);
+  ASSERT (wq != NULL);
+
+  work_init (&work, resubmit_work, NULL);
+  if (!work_submit (wq, &work))
+    fail ("work was not queued");
+  work_wait (&work);
+
+  if (run_cnt != RUN_CNT)
+    fail ("work_wait() returned after %d runs, expected %d",
+          run_cnt, RUN_CNT);
+  msg ("work ran %d times", run_cnt);
+  if (max_running != 1)
+    fail ("work ran on %d workers at once", max_running);
+  msg ("work never ran on two workers at once");
+}
+
+/* Resubmits the work item before sleeping, giving the other
+   workers every chance to pick it up while it is still
+   running. */
+static void
+resubmit_work (void *aux UNUSED) 
+{
+  int now_running = atomic_fetch_add (&running, 1) + 1;
+
+  if (now_running > max_running)
+    max_running = now_running;
+  if (++run_cnt < RUN_CNT && !work_submit (wq, &work))
+    fail ("running work could not be resubmitted");
+  timer_sleep (1);
+  atomic_dec (&running);
+}
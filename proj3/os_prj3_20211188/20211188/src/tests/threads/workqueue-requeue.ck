@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-requeue) begin
+(workqueue-requeue) work ran 20 times
+(workqueue-requeue) work never ran on two workers at once
+(workqueue-requeue) end
+EOF
+pass;
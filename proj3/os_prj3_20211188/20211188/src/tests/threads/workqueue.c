@@ -0,0 +1,62 @@
+/* Submits work to a queue with a single worker and checks that
+   it runs in submission order, that delayed work does not run
+   early, and that work_wait() waits for completion. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define WORK_CNT 5
+#define DELAY 10
+
+static work_func report_work, record_tick;
+
+void
+test_workqueue (void) 
+{
+  struct workqueue *wq;
+  struct work works[WORK_CNT];
+  struct work delayed;
+  int64_t start, ran_at;
+  int i;
+
+  wq = workqueue_create ("test", PRI_DEFAULT, 1);
+  ASSERT (wq != NULL);
+
+  for (i = 0; i < WORK_CNT; i++)
+    {
+      work_init (&works[i], report_work, (void *) i);
+      if (!work_submit (wq, &works[i]))
+        fail ("work %d was not queued", i);
+    }
+  for (i = 0; i < WORK_CNT; i++)
+    work_wait (&works[i]);
+  msg ("all work done");
+
+  work_init (&delayed, record_tick, &ran_at);
+  start = timer_ticks ();
+  work_submit_delayed (wq, &delayed, DELAY);
+  if (work_submit (wq, &delayed))
+    fail ("delayed work was queued twice");
+  work_wait (&delayed);
+  if (ran_at - start < DELAY)
+    fail ("delayed work ran after %lld ticks, expected at least %d",
+          ran_at - start, DELAY);
+  msg ("delayed work ran after at least %d ticks", DELAY);
+}
+
+static void
+report_work (void *id) 
+{
+  msg ("work %d running", (int) id);
+}
+
+static void
+record_tick (void *ran_at_) 
+{
+  int64_t *ran_at = ran_at_;
+  *ran_at = timer_ticks ();
+}
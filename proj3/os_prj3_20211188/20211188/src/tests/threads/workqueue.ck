@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) work 0 running
+(workqueue) work 1 running
+(workqueue) work 2 running
+(workqueue) work 3 running
+(workqueue) work 4 running
+(workqueue) all work done
+(workqueue) delayed work ran after at least 10 ticks
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Child process run by exec-churn.
+   Touches a few pages of BSS and stack, the way a short-lived
+   program does, and exits with status 1 if any BSS byte was not
+   zero to begin with. */
+
+#define PAGE_CNT 8
+
+static char bss[PAGE_CNT * 4096];
+
+int
+main (void) 
+{
+  char stack[2 * 4096];
+  int i;
+
+  for (i = 0; i < (int) sizeof bss; i += 512)
+    {
+      if (bss[i] != 0)
+        return 1;
+      bss[i] = i;
+    }
+  for (i = 0; i < (int) sizeof stack; i += 512)
+    stack[i] = bss[i];
+  return stack[0];
+}
@@ -0,0 +1,8 @@
+/* Child process run by exec-wait-many.
+   Exits immediately without printing anything. */
+
+int
+main (void) 
+{
+  return 0;
+}
@@ -0,0 +1,19 @@
+/* Child process run by fpu-switch.
+   Overwrites the SSE and x87 registers and exits. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+
+int
+main (void) 
+{
+  static const uint32_t junk[4] = {0, 0xffffffff, 0x55555555, 0xaaaaaaaa};
+  int64_t value = -1;
+
+  test_name = "child-fpu";
+
+  asm volatile ("movups %0, %%xmm0" : : "m" (junk));
+  asm volatile ("fninit; fildq %0" : : "m" (value));
+  msg ("run");
+  return 0;
+}
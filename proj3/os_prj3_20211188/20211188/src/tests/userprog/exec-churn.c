@@ -0,0 +1,31 @@
+/* Executes and waits for a short-lived child many times over, so
+   that page directories, page tables, and user pages are
+   allocated and freed at the rate of a busy shell.  Each child
+   checks that the pages it was given arrive zeroed.  Compare the
+   palloc statistics printed at shutdown to see how many
+   allocations the page caches served. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 500
+
+void
+test_main (void) 
+{
+  int i;
+
+  msg ("exec and wait for %d children", CHILD_CNT);
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = exec ("child-churn");
+      int status;
+
+      if (pid == PID_ERROR)
+        fail ("exec() of child %d failed", i);
+      status = wait (pid);
+      if (status != 0)
+        fail ("child %d exited with status %d", i, status);
+    }
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my ($CHILD_CNT) = 500;
+my ($expected) = "($test) begin\n"
+  . "($test) exec and wait for $CHILD_CNT children\n"
+  . "child-churn: exit(0)\n" x $CHILD_CNT
+  . "($test) end\n"
+  . "$test: exit(0)\n";
+check_expected ([$expected]);
+pass;
@@ -0,0 +1,21 @@
+/* Executes many child processes without ever waiting for them.
+   Each exited child must give back its thread page right away,
+   so this runs out of kernel memory if exited children are kept
+   around until their parent waits. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 1000
+
+void
+test_main (void) 
+{
+  int i;
+
+  msg ("exec %d children without waiting", CHILD_CNT);
+  for (i = 0; i < CHILD_CNT; i++)
+    if (exec ("child-empty") == PID_ERROR)
+      fail ("exec() of child %d failed", i);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(exec-nowait-many) begin
+(exec-nowait-many) exec 1000 children without waiting
+(exec-nowait-many) end
+EOF
+pass;
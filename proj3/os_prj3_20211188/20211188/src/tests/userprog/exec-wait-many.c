@@ -0,0 +1,29 @@
+/* Executes and waits for many child processes, one after
+   another, with thousands of tids allocated over the life of
+   the kernel.  Each wait() must find its child's record and
+   free it, or this runs out of kernel memory. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 2000
+
+void
+test_main (void) 
+{
+  int i;
+
+  msg ("exec and wait for %d children", CHILD_CNT);
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid = exec ("child-empty");
+      int status;
+
+      if (pid == PID_ERROR)
+        fail ("exec() of child %d failed", i);
+      status = wait (pid);
+      if (status != 0)
+        fail ("child %d exited with status %d", i, status);
+    }
+}
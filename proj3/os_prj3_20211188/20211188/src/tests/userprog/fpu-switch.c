@@ -0,0 +1,38 @@
+/* Loads values into an SSE register and the x87 stack, then runs
+   child processes that overwrite both, and checks that our
+   values are still there afterward. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void) 
+{
+  static const uint32_t pattern[4] = {0x01234567, 0x89abcdef,
+                                      0xdeadbeef, 0xcafef00d};
+  int64_t value = 0x123456789abcdefLL;
+  uint32_t xmm[4];
+  int64_t x87;
+  int i;
+
+  asm volatile ("movups %0, %%xmm0" : : "m" (pattern));
+  asm volatile ("fildq %0" : : "m" (value));
+
+  for (i = 0; i < CHILD_CNT; i++)
+    wait (exec ("child-fpu"));
+
+  asm volatile ("movups %%xmm0, %0" : "=m" (xmm));
+  asm volatile ("fistpq %0" : "=m" (x87));
+
+  if (memcmp (xmm, pattern, sizeof xmm))
+    fail ("SSE register changed: %08x %08x %08x %08x",
+          xmm[0], xmm[1], xmm[2], xmm[3]);
+  if (x87 != value)
+    fail ("x87 register changed");
+  msg ("FPU state preserved");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-switch) begin
+(child-fpu) run
+child-fpu: exit(0)
+(child-fpu) run
+child-fpu: exit(0)
+(child-fpu) run
+child-fpu: exit(0)
+(child-fpu) run
+child-fpu: exit(0)
+(fpu-switch) FPU state preserved
+(fpu-switch) end
+fpu-switch: exit(0)
+EOF
+pass;
@@ -0,0 +1,97 @@
+#ifndef THREADS_ATOMIC_H
+#define THREADS_ATOMIC_H
+
+#include <stdint.h>
+
+/* Atomic operations on 32- and 64-bit integers.
+
+   Each of these is a single locked instruction (or, for 64-bit
+   read-modify-write, a CMPXCHG8B retry loop), so they are safe
+   against interrupt handlers and other CPUs without turning
+   interrupts off.  All of them are also compiler barriers.
+
+   See [IA32-v2a] "LOCK", "XADD", "CMPXCHG", and [IA32-v2a]
+   "CMPXCHG8B". */
+
+/* Atomically adds 1 to *P. */
+static inline void
+atomic_inc (volatile int32_t *p)
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory");
+}
+
+/* Atomically subtracts 1 from *P. */
+static inline void
+atomic_dec (volatile int32_t *p)
+{
+  asm volatile ("lock decl %0" : "+m" (*p) : : "memory");
+}
+
+/* Atomically adds V to *P and returns the old value of *P. */
+static inline int32_t
+atomic_fetch_add (volatile int32_t *p, int32_t v)
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+  return v;
+}
+
+/* If *P equals OLD, atomically sets *P to NEW.
+   Returns the value *P had beforehand, so the exchange happened
+   if and only if the return value equals OLD. */
+static inline int32_t
+atomic_cmpxchg (volatile int32_t *p, int32_t old, int32_t new)
+{
+  int32_t prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* 64-bit version of atomic_cmpxchg(). */
+static inline int64_t
+atomic64_cmpxchg (volatile int64_t *p, int64_t old, int64_t new)
+{
+  int64_t prev;
+  asm volatile ("lock cmpxchg8b %1"
+                : "=A" (prev), "+m" (*p)
+                : "b" ((uint32_t) new), "c" ((uint32_t) (new >> 32)),
+                  "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically reads *P.  A plain 64-bit load is two 32-bit loads
+   on this CPU, and could see a torn value. */
+static inline int64_t
+atomic64_read (volatile int64_t *p)
+{
+  /* If *P happens to be 0, this stores 0 over it; otherwise it
+     just loads it.  Either way we get *P's value. */
+  return atomic64_cmpxchg (p, 0, 0);
+}
+
+/* Atomically adds V to *P and returns the old value of *P. */
+static inline int64_t
+atomic64_fetch_add (volatile int64_t *p, int64_t v)
+{
+  int64_t old = *p;
+
+  for (;;)
+    {
+      int64_t prev = atomic64_cmpxchg (p, old, old + v);
+      if (prev == old)
+        return old;
+      old = prev;
+    }
+}
+
+/* Atomically adds 1 to *P. */
+static inline void
+atomic64_inc (volatile int64_t *p)
+{
+  atomic64_fetch_add (p, 1);
+}
+
+#endif /* threads/atomic.h */
@@ -0,0 +1,232 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* CR0 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR0_MP 0x00000002       /* Monitor Coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task Switched. */
+#define CR0_NE 0x00000020       /* Numeric Error. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SSE exceptions raise #XF. */
+
+/* CPUID leaf 1 EDX feature bits. */
+#define CPUID_FXSR (1u << 24)
+#define CPUID_SSE (1u << 25)
+
+/* An FXSAVE area is 512 bytes and must be 16-byte aligned, which
+   malloc() does not promise, so we allocate a little extra. */
+#define FXSAVE_SIZE 512
+#define FXSAVE_ALIGN 16
+
+/* True if the CPU supports FXSAVE, so that user code may use
+   the FPU at all. */
+static bool fpu_enabled;
+
+/* Thread whose state is in the FPU registers, or a null pointer
+   if none is. */
+static struct thread *fpu_owner;
+
+/* FPU state that threads start out with. */
+static uint8_t initial_state[FXSAVE_SIZE] __attribute__ ((aligned (16)));
+
+/* Statistics. */
+static long long fpu_first_use_cnt;     /* Areas allocated. */
+static long long fpu_restore_cnt;       /* States reloaded by #NM. */
+
+static intr_handler_func fpu_trap;
+
+static inline uint32_t
+read_cr0 (void)
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+static inline void
+write_cr0 (uint32_t cr0)
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0) : "memory");
+}
+
+/* Sets CR0.TS, so that the next FPU instruction raises #NM. */
+static inline void
+stts (void)
+{
+  write_cr0 (read_cr0 () | CR0_TS);
+}
+
+/* Clears CR0.TS. */
+static inline void
+clts (void)
+{
+  asm volatile ("clts" : : : "memory");
+}
+
+static inline void
+fxsave (void *area)
+{
+  asm volatile ("fxsave %0" : "=m" (*(uint8_t (*)[FXSAVE_SIZE]) area));
+}
+
+static inline void
+fxrstor (const void *area)
+{
+  asm volatile ("fxrstor %0" : : "m" (*(const uint8_t (*)[FXSAVE_SIZE]) area));
+}
+
+/* Returns the aligned FXSAVE area of thread T. */
+static void *
+fxsave_area (const struct thread *t)
+{
+  return (void *) ROUND_UP ((uintptr_t) t->fpu, FXSAVE_ALIGN);
+}
+
+/* Enables the FPU and SSE for user code, if the CPU has FXSAVE,
+   and installs the #NM handler.  Until now the loader has kept
+   CR0.EM set, which makes any FPU instruction trap. */
+void
+fpu_init (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t cr4;
+  uint16_t fcw = 0x037f;        /* Default control word: all masked. */
+  uint32_t mxcsr = 0x1f80;      /* Default MXCSR: all masked. */
+
+  intr_register_int (7, 0, INTR_ON, fpu_trap,
+                     "#NM Device Not Available Exception");
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if (!(edx & CPUID_FXSR))
+    {
+      printf ("fpu: no FXSAVE support, floating point disabled\n");
+      return;
+    }
+
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_OSFXSR;
+  if (edx & CPUID_SSE)
+    cr4 |= CR4_OSXMMEXCPT;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+  write_cr0 ((read_cr0 () & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+
+  /* Capture a clean state for new threads. */
+  asm volatile ("fninit; fldcw %0" : : "m" (fcw));
+  if (edx & CPUID_SSE)
+    asm volatile ("ldmxcsr %0" : : "m" (mxcsr));
+  fxsave (initial_state);
+
+  stts ();
+  fpu_enabled = true;
+}
+
+/* Called on every switch to thread T, with interrupts off.  Lets
+   T use the FPU directly if it already owns it, and otherwise
+   arranges for its first FPU instruction to trap. */
+void
+fpu_activate (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!fpu_enabled)
+    return;
+  if (t == fpu_owner)
+    clts ();
+  else
+    stts ();
+}
+
+/* Frees the running thread's FPU state.  Called as the thread
+   exits. */
+void
+fpu_exit (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (cur->fpu == NULL)
+    return;
+
+  old_level = intr_disable ();
+  if (fpu_owner == cur)
+    {
+      fpu_owner = NULL;
+      stts ();
+    }
+  intr_set_level (old_level);
+
+  free (cur->fpu);
+  cur->fpu = NULL;
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void)
+{
+  if (fpu_first_use_cnt > 0)
+    printf ("FPU: %lld threads used it, %lld state reloads\n",
+            fpu_first_use_cnt, fpu_restore_cnt);
+}
+
+/* #NM handler.  Saves the FPU registers for their previous owner
+   and loads the running thread's, allocating its save area on
+   first use. */
+static void
+fpu_trap (struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  bool user = (f->cs & 3) == 3;
+  bool first_use = false;
+  enum intr_level old_level;
+
+  if (!fpu_enabled || !user)
+    {
+      /* The kernel never uses the FPU, and without FXSAVE
+         neither may user code. */
+      if (user)
+        {
+          printf ("%s: dying due to interrupt %#04x (%s).\n",
+                  thread_name (), f->vec_no, intr_name (f->vec_no));
+          thread_exit ();
+        }
+      intr_dump_frame (f);
+      PANIC ("Kernel bug - FPU used in kernel");
+    }
+
+  if (cur->fpu == NULL)
+    {
+      cur->fpu = malloc (FXSAVE_SIZE + FXSAVE_ALIGN - 1);
+      if (cur->fpu == NULL)
+        {
+          printf ("%s: out of memory for FPU state\n", thread_name ());
+          thread_exit ();
+        }
+      memcpy (fxsave_area (cur), initial_state, FXSAVE_SIZE);
+      first_use = true;
+    }
+
+  old_level = intr_disable ();
+  clts ();
+  if (fpu_owner != cur)
+    {
+      if (fpu_owner != NULL)
+        fxsave (fxsave_area (fpu_owner));
+      fxrstor (fxsave_area (cur));
+      fpu_owner = cur;
+      if (first_use)
+        fpu_first_use_cnt++;
+      else
+        fpu_restore_cnt++;
+    }
+  intr_set_level (old_level);
+}
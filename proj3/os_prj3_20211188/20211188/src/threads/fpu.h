@@ -0,0 +1,21 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+struct thread;
+
+/* Lazy x87/SSE state switching.
+
+   The kernel itself is built with -msoft-float and never touches
+   the FPU, so only user code does.  Each thread gets an FXSAVE
+   area the first time it executes an FPU or SSE instruction.
+   Switching threads only sets CR0.TS; the registers are saved
+   and reloaded by the #NM handler when a thread other than their
+   owner next uses them.  Threads that never use the FPU never
+   pay for it. */
+
+void fpu_init (void);
+void fpu_activate (struct thread *);
+void fpu_exit (void);
+void fpu_print_stats (void);
+
+#endif /* threads/fpu.h */
@@ -15,13 +15,16 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -107,16 +110,21 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  fpu_init ();
+  workqueue_init ();
   timer_init ();
   kbd_init ();
   input_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_start ();
+  palloc_init_zeroing ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -252,12 +260,34 @@ parse_options (char **argv)
         swap_bdev_name = value;
 #endif
 #endif
+      else if (!strcmp (name, "-mtrace"))
+        malloc_trace = true;
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
+      else if (!strcmp (name, "-bps"))
+        {
+          int bps = value != NULL ? atoi (value) : 0;
+
+          /* The 16550A divides 115,200 bps by an integer. */
+          if (bps < 300 || bps > 115200 || 115200 % bps != 0)
+            PANIC ("bad line rate `%s'", value);
+          serial_set_bps (bps);
+        }
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
       else if (!strcmp (name, "-aging")) 
         thread_aging = true;            // -aging 옵션 활성화
+      else if (!strcmp (name, "-ts"))
+        {
+          char *max = value != NULL ? strchr (value, ':') : NULL;
+
+          if (max == NULL)
+            PANIC ("-ts requires an argument of the form MIN:MAX");
+          thread_slice_min = atoi (value);
+          thread_slice_max = atoi (max + 1);
+          if (thread_slice_min < 1 || thread_slice_max < thread_slice_min)
+            PANIC ("bad time slices `%s'", value);
+        }
       else if (!strcmp (name, "-v"))    // -v 옵션 추가
         printf("Verbose mode enabled.\n");
       else if (!strcmp (name, "---q"))  // ---q 옵션 추가
@@ -301,6 +331,15 @@ run_task (char **argv)
   shutdown();
 }
 
+/* Prints memory allocator statistics. */
+static void
+run_meminfo (char **argv UNUSED)
+{
+  palloc_print_stats ();
+  malloc_print_stats ();
+  kmem_print_stats ();
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -318,6 +357,7 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"meminfo", 1, run_meminfo},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
@@ -366,6 +406,7 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  meminfo            Print memory allocator statistics.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -386,8 +427,12 @@ usage (void)
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
+          "  -mtrace            Record callers of live malloc() blocks.\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
+          "  -bps=BPS           Run the serial port at BPS bits per second.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -ts=MIN:MAX        Give PRI_MAX threads MIN-tick time slices,\n"
+          "                     PRI_MIN threads MAX, and interpolate.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -6,13 +6,16 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 
 /* A simple implementation of malloc().
 
    The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
+   of 2, or to one of two sizes that split a page three or two
+   ways, and assigned to the "descriptor" that manages blocks of
    that size.  The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
@@ -28,11 +31,20 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
+   We can't handle blocks bigger than about 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   realloc() resizes a block in place when it can: a normal block
+   whenever the new size still fits, a big block by giving pages
+   back from its end or by taking the free pages just after it.
+
+   Each descriptor counts its live blocks, arenas, and
+   allocations, for malloc_print_stats().  With -mtrace, we also
+   record the caller of every live allocation in a fixed-size hash
+   table, so that a leak can be traced to the code responsible. */
 
 /* Descriptor. */
 struct desc
@@ -41,6 +53,12 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by LOCK. */
+    size_t arena_cnt;           /* Arenas now allocated. */
+    size_t live_cnt;            /* Blocks now allocated. */
+    size_t peak_cnt;            /* Most blocks allocated at once. */
+    long long alloc_cnt;        /* Blocks ever allocated. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -61,11 +79,49 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[12];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks, protected by stats_lock. */
+static size_t big_live_cnt;     /* Big blocks now allocated. */
+static size_t big_page_cnt;     /* Pages in those blocks. */
+static size_t big_peak_cnt;     /* Most pages in big blocks at once. */
+static long long big_alloc_cnt; /* Big blocks ever allocated. */
+
+/* -mtrace: Record the caller of each live allocation? */
+bool malloc_trace;
+
+/* Number of slots in the trace table.  Must be a power of 2.
+   Only three quarters are ever filled, to keep probes short. */
+#define TRACE_SLOTS 1024
+
+/* A live allocation, in the trace table. */
+struct trace
+  {
+    void *block;                /* Block, or null if slot is empty. */
+    void *caller;               /* Return address in caller. */
+    size_t size;                /* Requested size. */
+  };
+
+/* Trace table, open addressing with linear probing, and the
+   number of blocks that did not fit.  Protected by stats_lock. */
+static struct trace traces[TRACE_SLOTS];
+static size_t trace_cnt;
+static size_t trace_dropped_cnt;
+
+/* Protects big block statistics and the trace table.  A
+   spinlock, because free() is called with interrupts off when
+   the scheduler reaps dying threads. */
+static struct spinlock stats_lock;
+
+static void init_desc (size_t block_size);
+static void *do_malloc (size_t, void *caller);
+static bool resize_in_place (void *block, size_t new_size);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void trace_add (void *block, size_t size, void *caller);
+static void trace_remove (void *block);
+static void trace_print (void);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -74,24 +130,77 @@ malloc_init (void)
   size_t block_size;
 
   for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
-    {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
-    }
+    init_desc (block_size);
+
+  /* Requests just too big for the largest power of 2 would
+     otherwise take a whole page each.  Split arenas three and
+     two ways for them instead. */
+  init_desc ((PGSIZE - sizeof (struct arena)) / 3 & ~3u);
+  init_desc ((PGSIZE - sizeof (struct arena)) / 2 & ~3u);
+
+  spinlock_init (&stats_lock, "malloc");
+}
+
+/* Initializes the next descriptor, for blocks of BLOCK_SIZE
+   bytes, which must be bigger than any before it. */
+static void
+init_desc (size_t block_size) 
+{
+  struct desc *d = &descs[desc_cnt++];
+
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  ASSERT (d == descs || d[-1].block_size < block_size);
+  d->block_size = block_size;
+  d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  list_init (&d->free_list);
+  lock_init (&d->lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return do_malloc (size, __builtin_return_address (0));
+}
+
+/* Prints memory allocator statistics: for each block size, the
+   blocks and arenas in use and the allocation rate, and the same
+   for big blocks.  With -mtrace, also prints the callers that
+   allocated the blocks that are still live.
+
+   The statistics are read without locking, because printing may
+   sleep and because this is also called at shutdown, so they may
+   be slightly inconsistent if other threads are allocating. */
+void
+malloc_print_stats (void)
+{
+  int64_t ticks = timer_ticks ();
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->alloc_cnt > 0)
+      printf ("Malloc: %zu-byte blocks: %zu live (peak %zu) in %zu arenas, "
+              "%lld allocs (%lld/s)\n",
+              d->block_size, d->live_cnt, d->peak_cnt, d->arena_cnt,
+              d->alloc_cnt,
+              ticks > 0 ? d->alloc_cnt * TIMER_FREQ / ticks : 0);
+  printf ("Malloc: big blocks: %zu live in %zu pages (peak %zu pages), "
+          "%lld allocs\n",
+          big_live_cnt, big_page_cnt, big_peak_cnt, big_alloc_cnt);
+  if (malloc_trace)
+    trace_print ();
+}
+
+/* Allocates a block of SIZE bytes for the function that
+   returns to CALLER. */
+static void *
+do_malloc (size_t size, void *caller) 
 {
   struct desc *d;
   struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -116,6 +225,16 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+
+      old_level = spinlock_acquire (&stats_lock);
+      big_live_cnt++;
+      big_page_cnt += page_cnt;
+      if (big_page_cnt > big_peak_cnt)
+        big_peak_cnt = big_page_cnt;
+      big_alloc_cnt++;
+      if (malloc_trace)
+        trace_add (a + 1, size, caller);
+      spinlock_release (&stats_lock, old_level);
       return a + 1;
     }
 
@@ -143,13 +262,24 @@ malloc (size_t size)
           struct block *b = arena_to_block (a, i);
           list_push_back (&d->free_list, &b->free_elem);
         }
+      d->arena_cnt++;
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  if (++d->live_cnt > d->peak_cnt)
+    d->peak_cnt = d->live_cnt;
+  d->alloc_cnt++;
   lock_release (&d->lock);
+
+  if (malloc_trace)
+    {
+      old_level = spinlock_acquire (&stats_lock);
+      trace_add (b, size, caller);
+      spinlock_release (&stats_lock, old_level);
+    }
   return b;
 }
 
@@ -167,7 +297,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = do_malloc (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -194,23 +324,69 @@ block_size (void *block)
 void *
 realloc (void *old_block, size_t new_size) 
 {
+  void *caller = __builtin_return_address (0);
+  void *new_block;
+  size_t old_size, min_size;
+
   if (new_size == 0) 
     {
       free (old_block);
       return NULL;
     }
-  else 
+  if (old_block == NULL)
+    return do_malloc (new_size, caller);
+
+  if (resize_in_place (old_block, new_size))
     {
-      void *new_block = malloc (new_size);
-      if (old_block != NULL && new_block != NULL)
+      if (malloc_trace)
         {
-          size_t old_size = block_size (old_block);
-          size_t min_size = new_size < old_size ? new_size : old_size;
-          memcpy (new_block, old_block, min_size);
-          free (old_block);
+          enum intr_level old_level = spinlock_acquire (&stats_lock);
+          trace_remove (old_block);
+          trace_add (old_block, new_size, caller);
+          spinlock_release (&stats_lock, old_level);
         }
-      return new_block;
+      return old_block;
     }
+
+  new_block = do_malloc (new_size, caller);
+  if (new_block != NULL)
+    {
+      old_size = block_size (old_block);
+      min_size = new_size < old_size ? new_size : old_size;
+      memcpy (new_block, old_block, min_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Tries to make BLOCK hold NEW_SIZE bytes without moving it.
+   Returns true if successful, false otherwise. */
+static bool
+resize_in_place (void *block, size_t new_size) 
+{
+  struct arena *a = block_to_arena (block);
+  enum intr_level old_level;
+  size_t page_cnt;
+
+  if (a->desc != NULL)
+    return new_size <= a->desc->block_size;
+
+  page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+  if (page_cnt < a->free_cnt)
+    palloc_free_multiple ((uint8_t *) a + PGSIZE * page_cnt,
+                          a->free_cnt - page_cnt);
+  else if (page_cnt > a->free_cnt
+           && !palloc_extend (a, a->free_cnt, page_cnt))
+    return false;
+
+  old_level = spinlock_acquire (&stats_lock);
+  big_page_cnt = big_page_cnt - a->free_cnt + page_cnt;
+  if (big_page_cnt > big_peak_cnt)
+    big_peak_cnt = big_page_cnt;
+  spinlock_release (&stats_lock, old_level);
+
+  a->free_cnt = page_cnt;
+  return true;
 }
 
 /* Frees block P, which must have been previously allocated with
@@ -223,6 +399,14 @@ free (void *p)
       struct block *b = p;
       struct arena *a = block_to_arena (b);
       struct desc *d = a->desc;
+      enum intr_level old_level;
+
+      if (malloc_trace)
+        {
+          old_level = spinlock_acquire (&stats_lock);
+          trace_remove (p);
+          spinlock_release (&stats_lock, old_level);
+        }
       
       if (d != NULL) 
         {
@@ -237,6 +421,7 @@ free (void *p)
 
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
+          d->live_cnt--;
 
           /* If the arena is now entirely unused, free it. */
           if (++a->free_cnt >= d->blocks_per_arena) 
@@ -250,6 +435,7 @@ free (void *p)
                   list_remove (&b->free_elem);
                 }
               palloc_free_page (a);
+              d->arena_cnt--;
             }
 
           lock_release (&d->lock);
@@ -257,6 +443,10 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          old_level = spinlock_acquire (&stats_lock);
+          big_live_cnt--;
+          big_page_cnt -= a->free_cnt;
+          spinlock_release (&stats_lock, old_level);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
@@ -292,3 +482,115 @@ arena_to_block (struct arena *a, size_t idx)
                            + sizeof *a
                            + idx * a->desc->block_size);
 }
+
+/* Returns the trace table slot where BLOCK belongs. */
+static size_t
+trace_hash (const void *block) 
+{
+  return ((uintptr_t) block >> 4) * 2654435761u & (TRACE_SLOTS - 1);
+}
+
+/* Records that BLOCK, of SIZE bytes, was allocated by the
+   function that returns to CALLER.  stats_lock must be held. */
+static void
+trace_add (void *block, size_t size, void *caller) 
+{
+  size_t i;
+
+  ASSERT (spinlock_held_by_current_thread (&stats_lock));
+
+  if (trace_cnt >= TRACE_SLOTS / 4 * 3)
+    {
+      trace_dropped_cnt++;
+      return;
+    }
+
+  for (i = trace_hash (block); traces[i].block != NULL;
+       i = (i + 1) & (TRACE_SLOTS - 1))
+    continue;
+  traces[i].block = block;
+  traces[i].caller = caller;
+  traces[i].size = size;
+  trace_cnt++;
+}
+
+/* Removes BLOCK from the trace table, if it is there.
+   stats_lock must be held. */
+static void
+trace_remove (void *block) 
+{
+  size_t i, j;
+
+  ASSERT (spinlock_held_by_current_thread (&stats_lock));
+
+  for (i = trace_hash (block); traces[i].block != block;
+       i = (i + 1) & (TRACE_SLOTS - 1))
+    if (traces[i].block == NULL)
+      return;
+
+  /* Move later entries in the same run back into the hole, if
+     that is no earlier than their home slot, so that lookups
+     never stop early at an empty slot. */
+  for (j = (i + 1) & (TRACE_SLOTS - 1); traces[j].block != NULL;
+       j = (j + 1) & (TRACE_SLOTS - 1))
+    {
+      size_t home = trace_hash (traces[j].block);
+      if (((j - home) & (TRACE_SLOTS - 1)) >= ((j - i) & (TRACE_SLOTS - 1)))
+        {
+          traces[i] = traces[j];
+          i = j;
+        }
+    }
+  traces[i].block = NULL;
+  trace_cnt--;
+}
+
+/* Prints the live blocks in the trace table, grouped by caller,
+   then the callers' addresses on one line for utils/backtrace. */
+static void
+trace_print (void) 
+{
+  size_t i, j;
+
+  printf ("Malloc: %zu live blocks traced, %zu not traced\n",
+          trace_cnt, trace_dropped_cnt);
+  if (trace_cnt == 0)
+    return;
+
+  for (i = 0; i < TRACE_SLOTS; i++)
+    {
+      size_t block_cnt = 0, byte_cnt = 0;
+
+      /* Report each caller at its first slot only. */
+      if (traces[i].block == NULL)
+        continue;
+      for (j = 0; j < i; j++)
+        if (traces[j].block != NULL && traces[j].caller == traces[i].caller)
+          break;
+      if (j < i)
+        continue;
+
+      for (j = i; j < TRACE_SLOTS; j++)
+        if (traces[j].block != NULL && traces[j].caller == traces[i].caller)
+          {
+            block_cnt++;
+            byte_cnt += traces[j].size;
+          }
+      printf ("Malloc: %p: %zu blocks, %zu bytes\n",
+              traces[i].caller, block_cnt, byte_cnt);
+    }
+
+  printf ("Callers:");
+  for (i = 0; i < TRACE_SLOTS; i++)
+    if (traces[i].block != NULL)
+      {
+        for (j = 0; j < i; j++)
+          if (traces[j].block != NULL && traces[j].caller == traces[i].caller)
+            break;
+        if (j == i)
+          printf (" %p", traces[i].caller);
+      }
+  printf (".\n"
+          "Run the `backtrace' program on these addresses to find the\n"
+          "functions that allocated the live blocks.\n");
+}
@@ -2,14 +2,18 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -25,20 +29,119 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
+/* Free memory in each pool is managed by a binary buddy
+   allocator.  Page indexes within the pool are split into
+   naturally aligned blocks of 2**ORDER pages, each free block is
+   on the free list for its order, and a freed block is merged
+   with its "buddy", the other half of the next larger block,
+   whenever that is free too.  Allocating and freeing therefore
+   take O(log n) time however full the pool is.
+
+   A request that is not a power of two is carved out of the
+   smallest block large enough, and the pages left over are freed
+   straight away, so that exactly PAGE_CNT pages are used.
+
+   The bitmap of used pages is kept for accounting and for
+   catching double frees. */
+
+/* In front of each pool sit two caches of single pages, so that
+   the common case of allocating and freeing one page does not
+   take the pool lock:
+
+   - A "magazine" of free pages per CPU.  It is refilled from the
+     pool, and flushed back to it, half a magazine at a time.
+     Since a CPU's magazine is only used by that CPU, turning
+     interrupts off is enough to protect it.  (There is only one
+     CPU, hence only one magazine per pool.)
+
+   - A stock of pages that have already been zeroed, for
+     PAL_ZERO requests.  They are zeroed by a work item on a
+     PRI_MIN work queue, whose worker is a background thread, so
+     it only uses time that would otherwise be idle, even under
+     the MLFQS or aging.  It zeroes each page with interrupts
+     off, which takes about a microsecond, so that a page is
+     never in limbo between the magazine and the stock.
+
+   Pages in either cache count as used in the pool's bitmap of
+   used pages, and are also marked in a second bitmap of cached
+   pages, so that freeing a page that is already in a cache is
+   caught as a double free too.  When a multi-page request fails, the caches are drained back
+   into the pool and it is retried. */
+
+/* Largest block, as a power of two number of pages. */
+#define MAX_ORDER 16
+
+#define MAG_SIZE 32             /* Pages per magazine. */
+#define ZEROED_MAX 32           /* Most pre-zeroed pages to keep. */
+#define ZEROED_LOW 16           /* Start zeroing below this many. */
+
+/* A per-CPU cache of free pages. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of pages. */
+    void *pages[MAG_SIZE];              /* Pages, top at end. */
+  };
+
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    struct spinlock lock;               /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *cached_map;          /* Bitmap of cached pages. */
+    uint8_t *order_map;                 /* Order of each free block. */
+    size_t page_cnt;                    /* Number of pages. */
+    struct list free[MAX_ORDER + 1];    /* Free blocks, by order. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Caches, protected by turning interrupts off. */
+    struct magazine mag;                /* Free pages. */
+    size_t zeroed_cnt;                  /* Number of pre-zeroed pages. */
+    void *zeroed[ZEROED_MAX];           /* Pre-zeroed pages. */
+
+    /* Statistics, protected by turning interrupts off. */
+    size_t used_cnt;                    /* Pages handed out. */
+    size_t peak_cnt;                    /* Most pages handed out at once. */
+  };
+
+/* Header at the start of each free block. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in free list. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Whether single pages go through the caches. */
+static bool caching = true;
+
+/* Work queue and work item that top up the stocks of zeroed
+   pages, once zeroing has started. */
+static struct workqueue *zero_wq;
+static struct work zero_work;
+
+/* Statistics. */
+static long long mag_hit_cnt;           /* Pages from a magazine. */
+static long long mag_refill_cnt;        /* Magazine refills. */
+static long long mag_flush_cnt;         /* Magazine flushes. */
+static long long zeroed_hit_cnt;        /* PAL_ZERO served pre-zeroed. */
+static long long zeroed_miss_cnt;       /* PAL_ZERO zeroed on demand. */
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static bool buddy_claim (struct pool *, size_t page_idx, size_t page_cnt);
+static void *pool_get (struct pool *, size_t page_cnt);
+static void *mag_get (struct pool *);
+static void *cache_get (struct pool *, bool zero, bool *zeroed);
+static void cache_put (struct pool *, void *page);
+static void *cache_mark (struct pool *, void *page, bool cached);
+static void cache_drain (struct pool *);
+static void print_pool_stats (struct pool *);
+static work_func zero_pages;
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -61,6 +164,18 @@ palloc_init (size_t user_page_limit)
              user_pages, "user pool");
 }
 
+/* Starts zeroing free pages in the background.  Must be called
+   after workqueue_start(). */
+void
+palloc_init_zeroing (void)
+{
+  work_init (&zero_work, zero_pages, NULL);
+  zero_wq = workqueue_create ("pagezero", PRI_MIN, 1);
+  if (zero_wq == NULL)
+    PANIC ("cannot create page zeroing work queue");
+  work_submit (zero_wq, &zero_work);
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -72,24 +187,28 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
-  size_t page_idx;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+  if (page_cnt == 1 && caching)
+    pages = cache_get (pool, flags & PAL_ZERO, &zeroed);
   else
-    pages = NULL;
+    pages = pool_get (pool, page_cnt);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      enum intr_level old_level;
+
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
+
+      old_level = intr_disable ();
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_cnt)
+        pool->peak_cnt = pool->used_cnt;
+      intr_set_level (old_level);
     }
   else 
     {
@@ -119,6 +238,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -138,7 +258,65 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 #endif
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  ASSERT (bitmap_none (pool->cached_map, page_idx, page_cnt));
+
+  old_level = intr_disable ();
+  ASSERT (pool->used_cnt >= page_cnt);
+  pool->used_cnt -= page_cnt;
+  intr_set_level (old_level);
+
+  if (page_cnt == 1 && caching)
+    cache_put (pool, pages);
+  else
+    {
+      /* A spinlock, because the scheduler frees dying threads'
+         pages with interrupts off. */
+      old_level = spinlock_acquire (&pool->lock);
+      buddy_free (pool, page_idx, page_cnt);
+      spinlock_release (&pool->lock, old_level);
+    }
+}
+
+/* Tries to extend the PAGE_CNT pages at PAGES, which must have
+   been allocated together, to NEW_PAGE_CNT pages, by allocating
+   the pages just after them.  Returns true if successful, false
+   if any of those pages is not free.  The new pages are not
+   zeroed. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_page_cnt)
+{
+  struct pool *pool;
+  size_t page_idx;
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (pg_ofs (pages) == 0);
+  ASSERT (page_cnt > 0);
+  if (new_page_cnt <= page_cnt)
+    return true;
+
+  if (page_from_pool (&kernel_pool, pages))
+    pool = &kernel_pool;
+  else if (page_from_pool (&user_pool, pages))
+    pool = &user_pool;
+  else
+    NOT_REACHED ();
+
+  page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+  if (page_idx + (new_page_cnt - page_cnt) > pool->page_cnt)
+    return false;
+
+  old_level = spinlock_acquire (&pool->lock);
+  success = buddy_claim (pool, page_idx, new_page_cnt - page_cnt);
+  if (success)
+    {
+      pool->used_cnt += new_page_cnt - page_cnt;
+      if (pool->used_cnt > pool->peak_cnt)
+        pool->peak_cnt = pool->used_cnt;
+    }
+  spinlock_release (&pool->lock, old_level);
+
+  return success;
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +326,48 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Turns the single-page caches on or off.  Turning them off
+   returns every cached page to its pool. */
+void
+palloc_set_caching (bool on)
+{
+  enum intr_level old_level;
+
+  caching = on;
+  if (on)
+    return;
+
+  old_level = intr_disable ();
+  cache_drain (&kernel_pool);
+  cache_drain (&user_pool);
+  intr_set_level (old_level);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+  printf ("Palloc: %lld cached page allocations, %lld refills, "
+          "%lld flushes\n", mag_hit_cnt, mag_refill_cnt, mag_flush_cnt);
+  printf ("Palloc: %lld pre-zeroed pages used, %lld zeroed on demand\n",
+          zeroed_hit_cnt, zeroed_miss_cnt);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map, cached_map, and order_map at
+     its base.  Calculate the space needed for them and subtract
+     it from the pool's size. */
+  size_t bm_pages = DIV_ROUND_UP (2 * bitmap_buf_size (page_cnt) + page_cnt,
+                                  PGSIZE);
+  size_t bm_size;
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +375,46 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  spinlock_init (&p->lock, name);
+  bm_size = bitmap_buf_size (page_cnt);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->cached_map = bitmap_create_in_buf (page_cnt, (uint8_t *) base + bm_size,
+                                        bm_size);
+  p->order_map = (uint8_t *) base + 2 * bm_size;
+  p->page_cnt = page_cnt;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free[order]);
   p->base = base + bm_pages * PGSIZE;
+  p->name = name;
+  p->used_cnt = p->peak_cnt = 0;
+  p->mag.cnt = 0;
+  p->zeroed_cnt = 0;
+
+  /* Everything starts out allocated, then is freed. */
+  bitmap_set_all (p->used_map, true);
+  bitmap_set_all (p->cached_map, false);
+  buddy_free (p, 0, page_cnt);
+}
+
+/* Prints the page usage of POOL.  Pages are either handed out,
+   held in the caches, or free in the buddy lists. */
+static void
+print_pool_stats (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t used_cnt, peak_cnt, cached_cnt, free_cnt;
+
+  old_level = spinlock_acquire (&pool->lock);
+  used_cnt = pool->used_cnt;
+  peak_cnt = pool->peak_cnt;
+  cached_cnt = pool->mag.cnt + pool->zeroed_cnt;
+  free_cnt = bitmap_count (pool->used_map, 0, pool->page_cnt, false);
+  spinlock_release (&pool->lock, old_level);
+
+  printf ("Palloc: %s: %zu of %zu pages in use (peak %zu), "
+          "%zu cached, %zu free\n",
+          pool->name, used_cnt, pool->page_cnt, peak_cnt, cached_cnt,
+          free_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +428,349 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free block header for page PAGE_IDX in POOL. */
+static struct free_block *
+block_at (const struct pool *pool, size_t page_idx)
+{
+  return (struct free_block *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX in POOL on
+   its free list. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->order_map[page_idx] = order;
+  list_push_front (&pool->free[order], &block_at (pool, page_idx)->elem);
+}
+
+/* Like push_block(), but first merges the block with its buddy
+   as many times as possible. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order < MAX_ORDER)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      /* The buddy's first page is free only if it heads a free
+         block, since a free block containing it would contain
+         our block too.  Merge if that block is whole. */
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || bitmap_test (pool->used_map, buddy)
+          || pool->order_map[buddy] != order)
+        break;
+
+      list_remove (&block_at (pool, buddy)->elem);
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Marks the PAGE_CNT pages at PAGE_IDX in POOL free, splitting
+   them into as few aligned blocks as possible.  Each block is
+   only marked free in the bitmap as it is freed, so that
+   free_block() does not mistake a later one for a free buddy. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order < MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order,
+                           false);
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates the PAGE_CNT pages at PAGE_IDX in POOL, if they are
+   all free.  Returns true if successful, false otherwise.  Each
+   free block that overlaps the range is taken off its free list
+   whole, and the part of it outside the range is freed again. */
+static bool
+buddy_claim (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t end = page_idx + page_cnt;
+  size_t page;
+
+  if (!bitmap_none (pool->used_map, page_idx, page_cnt))
+    return false;
+
+  for (page = page_idx; page < end; )
+    {
+      size_t head = 0, size = 0;
+      int order;
+
+      /* Find the free block containing PAGE.  Look from the top
+         down: order_map is stale for pages that are inside a free
+         block without heading it, but an aligned block big enough
+         to hold the real one cannot be headed by such a page. */
+      for (order = MAX_ORDER; order >= 0; order--)
+        {
+          size = (size_t) 1 << order;
+          head = page & ~(size - 1);
+          if (head + size <= pool->page_cnt
+              && !bitmap_test (pool->used_map, head)
+              && pool->order_map[head] == order)
+            break;
+        }
+      ASSERT (order >= 0);
+
+      list_remove (&block_at (pool, head)->elem);
+      bitmap_set_multiple (pool->used_map, head, size, true);
+      if (head < page_idx)
+        buddy_free (pool, head, page_idx - head);
+      if (head + size > end)
+        buddy_free (pool, end, head + size - end);
+      page = head + size;
+    }
+  return true;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no block is large
+   enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  int want = 0, order;
+  size_t page_idx;
+
+  while (((size_t) 1 << want) < page_cnt)
+    if (++want > MAX_ORDER)
+      return BITMAP_ERROR;
+
+  /* Smallest free block that is large enough. */
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free[order]))
+      break;
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  page_idx = ((uint8_t *) list_pop_front (&pool->free[order]) - pool->base)
+             / PGSIZE;
+
+  /* Split off upper halves until the block is the right size.
+     They cannot be merged back with what we keep, of course. */
+  while (order > want)
+    {
+      order--;
+      push_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  ASSERT (bitmap_none (pool->used_map, page_idx, (size_t) 1 << want));
+  bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << want, true);
+
+  /* Give back what we don't need. */
+  if (page_cnt < ((size_t) 1 << want))
+    buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages straight from POOL.  If
+   there are none, drains the caches back into POOL and tries
+   again. */
+static void *
+pool_get (struct pool *pool, size_t page_cnt)
+{
+  enum intr_level old_level;
+  size_t page_idx;
+
+  old_level = spinlock_acquire (&pool->lock);
+  page_idx = buddy_alloc (pool, page_cnt);
+  spinlock_release (&pool->lock, old_level);
+
+  if (page_idx == BITMAP_ERROR)
+    {
+      old_level = intr_disable ();
+      cache_drain (pool);
+      spinlock_acquire (&pool->lock);
+      page_idx = buddy_alloc (pool, page_cnt);
+      spinlock_release (&pool->lock, INTR_OFF);
+      intr_set_level (old_level);
+    }
+
+  return page_idx != BITMAP_ERROR ? pool->base + PGSIZE * page_idx : NULL;
+}
+
+/* Takes a page from POOL's magazine, refilling it from the pool
+   if it is empty.  Returns a null pointer if the pool is empty
+   too.  Interrupts must be off. */
+static void *
+mag_get (struct pool *pool)
+{
+  struct magazine *mag = &pool->mag;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (mag->cnt == 0)
+    {
+      spinlock_acquire (&pool->lock);
+      while (mag->cnt < MAG_SIZE / 2)
+        {
+          size_t page_idx = buddy_alloc (pool, 1);
+          void *page;
+
+          if (page_idx == BITMAP_ERROR)
+            break;
+          page = pool->base + PGSIZE * page_idx;
+          mag->pages[mag->cnt++] = cache_mark (pool, page, true);
+        }
+      spinlock_release (&pool->lock, INTR_OFF);
+      mag_refill_cnt++;
+    }
+  else
+    mag_hit_cnt++;
+
+  return (mag->cnt > 0
+          ? cache_mark (pool, mag->pages[--mag->cnt], false) : NULL);
+}
+
+/* Allocates a single page from POOL's caches, falling back to
+   the pool itself.  If ZERO is true, prefers a pre-zeroed page.
+   Sets *ZEROED to true if the page returned is known to be
+   zeroed. */
+static void *
+cache_get (struct pool *pool, bool zero, bool *zeroed)
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = intr_disable ();
+  if (!zero || pool->zeroed_cnt == 0)
+    page = mag_get (pool);
+  if (page == NULL && pool->zeroed_cnt > 0)
+    {
+      page = cache_mark (pool, pool->zeroed[--pool->zeroed_cnt], false);
+      *zeroed = true;
+    }
+  if (zero)
+    {
+      if (*zeroed)
+        zeroed_hit_cnt++;
+      else
+        zeroed_miss_cnt++;
+    }
+
+  /* Have the stock topped up.  Only take the work lock if the
+     work is idle: if it is running, it keeps going until the
+     stock is full, and if it has just stopped, the next
+     allocation queues it again. */
+  if (pool->zeroed_cnt < ZEROED_LOW && zero_wq != NULL
+      && zero_work.state == WORK_IDLE)
+    work_submit (zero_wq, &zero_work);
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Returns PAGE to POOL's magazine, first flushing half of the
+   magazine back to the pool if it is full. */
+static void
+cache_put (struct pool *pool, void *page)
+{
+  struct magazine *mag = &pool->mag;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  cache_mark (pool, page, true);
+  if (mag->cnt == MAG_SIZE)
+    {
+      spinlock_acquire (&pool->lock);
+      while (mag->cnt > MAG_SIZE / 2)
+        {
+          void *p = cache_mark (pool, mag->pages[--mag->cnt], false);
+          buddy_free (pool, pg_no (p) - pg_no (pool->base), 1);
+        }
+      spinlock_release (&pool->lock, INTR_OFF);
+      mag_flush_cnt++;
+    }
+  mag->pages[mag->cnt++] = page;
+  intr_set_level (old_level);
+}
+
+/* Marks PAGE in POOL as being in one of POOL's caches if CACHED
+   is true, or as having left them if it is false, and returns
+   PAGE.  Panics if PAGE is already in the state requested, which
+   means that a page in a cache was freed again.  Interrupts must
+   be off. */
+static void *
+cache_mark (struct pool *pool, void *page, bool cached)
+{
+  size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (bitmap_test (pool->cached_map, page_idx) == cached)
+    PANIC ("palloc: page %p %s", page,
+           cached ? "freed twice" : "not in a cache");
+  bitmap_set (pool->cached_map, page_idx, cached);
+  return page;
+}
+
+/* Returns every page in POOL's caches to the pool.  Interrupts
+   must be off. */
+static void
+cache_drain (struct pool *pool)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spinlock_acquire (&pool->lock);
+  while (pool->mag.cnt > 0)
+    {
+      void *p = cache_mark (pool, pool->mag.pages[--pool->mag.cnt], false);
+      buddy_free (pool, pg_no (p) - pg_no (pool->base), 1);
+    }
+  while (pool->zeroed_cnt > 0)
+    {
+      void *p = cache_mark (pool, pool->zeroed[--pool->zeroed_cnt], false);
+      buddy_free (pool, pg_no (p) - pg_no (pool->base), 1);
+    }
+  spinlock_release (&pool->lock, INTR_OFF);
+}
+
+/* Zeroes one page from POOL's magazine and adds it to POOL's
+   stock of zeroed pages.  Returns false if the stock is full or
+   there are no free pages.  Interrupts must be off. */
+static bool
+zero_one (struct pool *pool)
+{
+  void *page;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!caching || pool->zeroed_cnt >= ZEROED_MAX)
+    return false;
+  page = mag_get (pool);
+  if (page == NULL)
+    return false;
+  memset (page, 0, PGSIZE);
+  pool->zeroed[pool->zeroed_cnt++] = cache_mark (pool, page, true);
+  return true;
+}
+
+/* Work function that tops up both pools' stocks of zeroed pages
+   a page at a time.  It is queued again when cache_get() finds a
+   stock running low. */
+static void
+zero_pages (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      bool zeroed = zero_one (&kernel_pool) || zero_one (&user_pool);
+      intr_set_level (old_level);
+      if (!zeroed)
+        break;
+    }
+}
@@ -0,0 +1,352 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/vaddr.h"
+
+/* Each slab is one page.  The slab header sits at the start of
+   the page, followed by one "next free" index per object, then
+   the objects themselves.  Keeping the free list out of the
+   objects is what lets a freed object stay constructed.
+
+   Any space left over at the end of the page is used for
+   colouring: each new slab starts its objects a little further
+   into the page than the last, cycling through the leftover
+   space, so that the same object in different slabs does not
+   always land in the same cache lines.
+
+   Objects freed on a CPU go onto that CPU's magazine, a small
+   stack protected just by turning interrupts off.  Only when the
+   magazine runs empty or full do we take the cache's spinlock to
+   move half a magazine to or from the slabs.  (There is only one
+   CPU, hence one magazine per cache.) */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* No next free object. */
+#define FREE_END UINT16_MAX
+
+/* Objects per magazine. */
+#define MAG_SIZE 16
+
+/* Slab header. */
+struct slab
+  {
+    unsigned magic;             /* Always SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of cache's lists. */
+    uint8_t *objs;              /* First object. */
+    size_t inuse;               /* Objects allocated. */
+    uint16_t free;              /* Index of first free object. */
+    uint16_t next[];            /* Next free object, per object. */
+  };
+
+/* An object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t size;                /* Object size. */
+    size_t stride;              /* Distance between objects. */
+    size_t align;               /* Object alignment. */
+    kmem_ctor *ctor;            /* Constructor, or null. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    size_t colour_max;          /* Largest colour offset. */
+    size_t colour_next;         /* Colour offset for next slab. */
+    struct list_elem elem;      /* Element in all_caches. */
+
+    struct spinlock lock;       /* Protects the rest. */
+    struct list partial;        /* Slabs with some objects free. */
+    struct list full;           /* Slabs with no objects free. */
+    struct list empty;          /* Slabs with no objects in use. */
+
+    /* Per-CPU magazine, protected by turning interrupts off. */
+    size_t mag_cnt;
+    void *mag[MAG_SIZE];
+
+    /* Statistics. */
+    long long alloc_cnt;        /* Allocations. */
+    long long mag_hit_cnt;      /* Allocations from the magazine. */
+    size_t slab_cnt;            /* Slabs now allocated. */
+    size_t inuse_cnt;           /* Objects now allocated. */
+  };
+
+/* All the caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static void *slab_take (struct kmem_cache *);
+static void slab_give (struct kmem_cache *, void *obj);
+static struct slab *obj_to_slab (void *obj);
+
+/* Creates and returns a cache named NAME of SIZE-byte objects
+   aligned on ALIGN bytes, a power of 2, or on a pointer if ALIGN
+   is 0.  If CTOR is nonnull, it is run on every object as its slab
+   is created.  Returns a null pointer if memory is short or if
+   SIZE is too big to fit several objects in a page.  Caches live
+   until the kernel shuts down. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+                   kmem_ctor *ctor)
+{
+  struct kmem_cache *c;
+  size_t hdr, left;
+
+  ASSERT (size > 0);
+  if (align == 0)
+    align = sizeof (void *);
+  ASSERT ((align & (align - 1)) == 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  c->name = name;
+  c->size = size;
+  c->align = align;
+  c->stride = ROUND_UP (size, align);
+  c->ctor = ctor;
+
+  /* As many objects as fit with their free list entries. */
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab))
+                     / (c->stride + sizeof (uint16_t));
+  if (c->objs_per_slab < 2)
+    {
+      free (c);
+      return NULL;
+    }
+  hdr = ROUND_UP (sizeof (struct slab)
+                  + c->objs_per_slab * sizeof (uint16_t), align);
+  while (hdr + c->objs_per_slab * c->stride > PGSIZE)
+    {
+      c->objs_per_slab--;
+      hdr = ROUND_UP (sizeof (struct slab)
+                      + c->objs_per_slab * sizeof (uint16_t), align);
+    }
+  left = PGSIZE - hdr - c->objs_per_slab * c->stride;
+  c->colour_max = left - left % align;
+  c->colour_next = 0;
+
+  spinlock_init (&c->lock, name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->mag_cnt = 0;
+  c->alloc_cnt = c->mag_hit_cnt = 0;
+  c->slab_cnt = c->inuse_cnt = 0;
+
+  list_push_back (&all_caches, &c->elem);
+  return c;
+}
+
+/* Allocates and returns an object from cache C, or a null pointer
+   if memory is short.  The object is in its constructed state if
+   C has a constructor, and otherwise uninitialized. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  enum intr_level old_level;
+  void *obj;
+
+  old_level = intr_disable ();
+  c->alloc_cnt++;
+  if (c->mag_cnt > 0)
+    {
+      c->mag_hit_cnt++;
+      obj = c->mag[--c->mag_cnt];
+    }
+  else
+    obj = slab_take (c);
+  intr_set_level (old_level);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from C, to C.  Does
+   nothing if OBJ is null. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  enum intr_level old_level;
+
+  if (obj == NULL)
+    return;
+  ASSERT (obj_to_slab (obj)->cache == c);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->size);
+#endif
+
+  old_level = intr_disable ();
+  if (c->mag_cnt == MAG_SIZE)
+    {
+      /* Flush half the magazine. */
+      spinlock_acquire (&c->lock);
+      while (c->mag_cnt > MAG_SIZE / 2)
+        slab_give (c, c->mag[--c->mag_cnt]);
+      spinlock_release (&c->lock, INTR_OFF);
+    }
+  c->mag[c->mag_cnt++] = obj;
+  intr_set_level (old_level);
+}
+
+/* Prints statistics for every cache. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      printf ("Slab: %s: %zu-byte objects, %zu per slab, %zu slabs, "
+              "%zu in use, %lld allocs (%lld from magazine)\n",
+              c->name, c->size, c->objs_per_slab, c->slab_cnt,
+              c->inuse_cnt, c->alloc_cnt, c->mag_hit_cnt);
+    }
+}
+
+/* Takes an object for cache C from its slabs, creating a new
+   slab if necessary, and refills the magazine with up to half a
+   magazine more.  Interrupts must be off. */
+static void *
+slab_take (struct kmem_cache *c)
+{
+  void *obj = NULL;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spinlock_acquire (&c->lock);
+  while (c->mag_cnt < MAG_SIZE / 2 + 1)
+    {
+      struct slab *s;
+
+      if (!list_empty (&c->partial))
+        s = list_entry (list_front (&c->partial), struct slab, elem);
+      else if (!list_empty (&c->empty))
+        {
+          s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+          list_push_front (&c->partial, &s->elem);
+        }
+      else
+        {
+          /* Create the slab without the lock, since running the
+             constructors may take a while. */
+          spinlock_release (&c->lock, INTR_OFF);
+          s = slab_create (c);
+          spinlock_acquire (&c->lock);
+          if (s == NULL)
+            break;
+          c->slab_cnt++;
+          list_push_front (&c->partial, &s->elem);
+        }
+
+      c->mag[c->mag_cnt++] = s->objs + s->free * c->stride;
+      s->free = s->next[s->free];
+      s->inuse++;
+      c->inuse_cnt++;
+      if (s->free == FREE_END)
+        {
+          list_remove (&s->elem);
+          list_push_front (&c->full, &s->elem);
+        }
+    }
+  spinlock_release (&c->lock, INTR_OFF);
+
+  if (c->mag_cnt > 0)
+    obj = c->mag[--c->mag_cnt];
+  return obj;
+}
+
+/* Returns OBJ to its slab in cache C.  If that leaves the slab
+   unused, and C already has an unused slab, frees the slab.
+   C's lock must be held. */
+static void
+slab_give (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = obj_to_slab (obj);
+  size_t idx = ((uint8_t *) obj - s->objs) / c->stride;
+
+  ASSERT (spinlock_held_by_current_thread (&c->lock));
+  ASSERT (s->cache == c);
+  ASSERT ((uint8_t *) obj == s->objs + idx * c->stride);
+
+  if (s->free == FREE_END)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  s->next[idx] = s->free;
+  s->free = idx;
+  s->inuse--;
+  c->inuse_cnt--;
+
+  if (s->inuse == 0)
+    {
+      list_remove (&s->elem);
+      if (list_empty (&c->empty))
+        list_push_front (&c->empty, &s->elem);
+      else
+        {
+          s->magic = 0;
+          c->slab_cnt--;
+          palloc_free_page (s);
+        }
+    }
+}
+
+/* Allocates a new slab for cache C and constructs its objects.
+   Returns the slab, or a null pointer if memory is short. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t hdr, i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  hdr = ROUND_UP (sizeof *s + c->objs_per_slab * sizeof *s->next, c->align);
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->objs = (uint8_t *) s + hdr + c->colour_next;
+  s->inuse = 0;
+  s->free = 0;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : FREE_END;
+      if (c->ctor != NULL)
+        c->ctor (s->objs + i * c->stride);
+    }
+
+  /* Next slab gets the next colour. */
+  c->colour_next += c->align;
+  if (c->colour_next > c->colour_max)
+    c->colour_next = 0;
+
+  return s;
+}
+
+/* Returns the slab that OBJ is in. */
+static struct slab *
+obj_to_slab (void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  return s;
+}
@@ -0,0 +1,31 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out fixed-size objects of one kind, packed into
+   page-size slabs, so that a small object wastes only its share
+   of the slab header rather than the rest of a power-of-two
+   malloc() block.  See [Bonwick94].
+
+   If a cache has a constructor, it runs once on each object when
+   the object's slab is created, not on every allocation.  Objects
+   must be freed in their constructed state, e.g. with any lock
+   they contain released, so that the next allocation can skip
+   the constructor.
+
+   Each cache keeps a small per-CPU stack of free objects, so the
+   common allocate/free pair takes no lock. */
+
+/* Constructor for the objects in a cache. */
+typedef void kmem_ctor (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      size_t align, kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
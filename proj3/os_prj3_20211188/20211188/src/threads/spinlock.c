@@ -0,0 +1,128 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/atomic.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#ifndef NDEBUG
+/* Every spinlock ever initialized, most recent first, for
+   spinlock_print_stats(). */
+static struct spinlock *all_spinlocks;
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+#endif
+
+/* Initializes LOCK, which is named NAME, as unlocked. */
+void
+spinlock_init (struct spinlock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  lock->next = 0;
+  lock->owner = 0;
+  lock->name = name;
+#ifndef NDEBUG
+  lock->holder = NULL;
+  lock->acquired_at = 0;
+  lock->max_hold = 0;
+  {
+    enum intr_level old_level = intr_disable ();
+    lock->next_lock = all_spinlocks;
+    all_spinlocks = lock;
+    intr_set_level (old_level);
+  }
+#endif
+}
+
+/* Turns interrupts off, then waits for LOCK and acquires it.
+   Returns the interrupt level from before, to be passed to
+   spinlock_release().
+
+   Spinlocks are not recursive: acquiring a lock the current
+   thread already holds spins forever. */
+enum intr_level
+spinlock_acquire (struct spinlock *lock)
+{
+  enum intr_level old_level;
+  int32_t ticket;
+
+  ASSERT (lock != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!spinlock_held_by_current_thread (lock));
+
+  ticket = atomic_fetch_add (&lock->next, 1);
+  while (lock->owner != ticket)
+    asm volatile ("pause" : : : "memory");
+
+#ifndef NDEBUG
+  lock->holder = thread_current ();
+  lock->acquired_at = rdtsc ();
+#endif
+  return old_level;
+}
+
+/* Releases LOCK, which the current thread must hold, and
+   restores the interrupt level to OLD_LEVEL. */
+void
+spinlock_release (struct spinlock *lock, enum intr_level old_level)
+{
+  ASSERT (lock != NULL);
+  ASSERT (spinlock_held_by_current_thread (lock));
+
+#ifndef NDEBUG
+  {
+    uint64_t held = rdtsc () - lock->acquired_at;
+    if (held > lock->max_hold)
+      lock->max_hold = held;
+    lock->holder = NULL;
+  }
+#endif
+
+  /* Only the holder writes OWNER, so a plain increment is
+     enough; the barrier keeps the critical section's accesses
+     from moving past it. */
+  barrier ();
+  lock->owner++;
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds LOCK, false
+   otherwise.  With NDEBUG the holder is not tracked, so this
+   only tells whether anyone holds LOCK. */
+bool
+spinlock_held_by_current_thread (const struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+#ifndef NDEBUG
+  return lock->holder == thread_current ();
+#else
+  return lock->owner != lock->next;
+#endif
+}
+
+/* Prints the longest time each spinlock was held.  Reads the
+   statistics without taking the locks, because printing may
+   sleep, so a lock in use meanwhile may be reported slightly
+   stale. */
+void
+spinlock_print_stats (void)
+{
+#ifndef NDEBUG
+  struct spinlock *lock;
+
+  for (lock = all_spinlocks; lock != NULL; lock = lock->next_lock)
+    printf ("Spinlock: %s held at most %llu cycles\n",
+            lock->name, lock->max_hold);
+#endif
+}
@@ -0,0 +1,45 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* A ticket spinlock for short critical sections.
+
+   Acquiring a spinlock turns interrupts off and returns the
+   previous interrupt level, which must be passed back to
+   spinlock_release().  It can therefore be used to protect data
+   shared with interrupt handlers, in place of a bare
+   intr_disable()/intr_set_level() pair, and it names the data
+   being protected.  Tickets are served in order, so waiters on
+   a contended lock cannot starve.
+
+   A thread must not sleep while holding a spinlock: no
+   thread_block(), sema_down(), lock_acquire(), or anything that
+   can yield, such as sema_up() outside interrupt context.
+
+   Unless NDEBUG is defined, each lock also records its holder
+   and the longest time, in TSC cycles, that it was held, which
+   spinlock_print_stats() reports at shutdown.  Spinlocks are
+   expected to live until then. */
+struct spinlock
+  {
+    volatile int32_t next;      /* Next ticket to hand out. */
+    volatile int32_t owner;     /* Ticket now allowed in. */
+    const char *name;           /* Name, for debugging. */
+#ifndef NDEBUG
+    struct thread *holder;      /* Thread holding the lock. */
+    uint64_t acquired_at;       /* TSC when acquired. */
+    uint64_t max_hold;          /* Longest hold, in TSC cycles. */
+    struct spinlock *next_lock; /* Next in list of all spinlocks. */
+#endif
+  };
+
+void spinlock_init (struct spinlock *, const char *name);
+enum intr_level spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *, enum intr_level);
+bool spinlock_held_by_current_thread (const struct spinlock *);
+void spinlock_print_stats (void);
+
+#endif /* threads/spinlock.h */
@@ -65,8 +65,13 @@ void sema_down (struct semaphore *sema) {
 
   old_level = intr_disable ();
   while (sema->value == 0) {
-    list_insert_ordered(&sema->waiters, &thread_current()->elem, 
+    struct thread *cur = thread_current ();
+
+    /* Equal priorities go behind each other, so waiters at one
+       priority are woken in FIFO order. */
+    list_insert_ordered(&sema->waiters, &cur->elem, 
                         (list_less_func *)&compare_priority, NULL);
+    cur->waiting_on = sema;
     thread_block ();
   }
   sema->value--;
@@ -102,27 +107,50 @@ sema_try_down (struct semaphore *sema)
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
+   The waiters are kept in priority order, so that is the one at
+   the front.  If it has a higher priority than the running
+   thread, the running thread yields to it.
 
    This function may be called from an interrupt handler. */
 void sema_up (struct semaphore *sema) {
   enum intr_level old_level;
+  bool preempt = false;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
   if (!list_empty(&sema->waiters)) {
-    list_sort(&sema->waiters, (list_less_func *)&compare_priority, NULL);
     struct thread *highest_priority_thread = 
         list_entry(list_pop_front(&sema->waiters), struct thread, elem);
+    highest_priority_thread->waiting_on = NULL;
     thread_unblock(highest_priority_thread);
+    preempt = highest_priority_thread->priority > thread_current ()->priority;
   }
   sema->value++;
-  if (!intr_context()) {
-    thread_yield(); // 현재 스레드의 우선순위보다 높은 스레드가 있으면 양보
+  if (preempt && !intr_context()) {
+    thread_yield(); // 깨운 스레드의 우선순위가 더 높을 때만 양보
   }
   intr_set_level (old_level);
 }
 
+/* Moves T, which is blocked in sema_down(), to its place in its
+   semaphore's waiter list.  Must be called, with interrupts off,
+   whenever a waiting thread's priority changes, so that sema_up()
+   can keep taking the front of the list without sorting it. */
+void
+sema_reorder_waiter (struct thread *t)
+{
+  struct semaphore *sema = t->waiting_on;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_BLOCKED);
+  ASSERT (sema != NULL);
+
+  list_remove (&t->elem);
+  list_insert_ordered (&sema->waiters, &t->elem,
+                       (list_less_func *) &compare_priority, NULL);
+}
+
 
 
 static void sema_test_helper (void *sema_);
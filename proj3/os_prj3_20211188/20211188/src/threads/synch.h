@@ -4,6 +4,8 @@
 #include <list.h>
 #include <stdbool.h>
 
+struct thread;
+
 /* A counting semaphore. */
 struct semaphore 
   {
@@ -15,6 +17,7 @@ void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_reorder_waiter (struct thread *);
 void sema_self_test (void);
 
 /* Lock. */
@@ -4,10 +4,13 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/atomic.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,21 +26,13 @@ static int load_avg;
 #define THREAD_MAGIC 0xcd6abf4b
 #define FRACTION (1 << 14)
 struct list all_list;
+
+/* Protects all_list.  Taken from the timer interrupt, so this is
+   a spinlock. */
+static struct spinlock all_lock;
 void
 thread_init (void);
 
-struct thread *get_thread_by_tid(tid_t tid) {
-  struct list_elem *e;
-  for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-    struct thread *t = list_entry(e, struct thread, allelem);
-    if (t->tid == tid) {
-      return t;
-    }
-  }
-
-  return NULL; // 해당 tid의 스레드가 없을 경우 NULL 반환
-}
-
 /* List of processes in THREAD_READY state, that is, processes
    that are ready to run but not actually running. */
 static struct list ready_list;
@@ -52,9 +47,6 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
-
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -78,6 +70,15 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 bool thread_mlfqs;
 bool thread_aging=false;
 
+/* Time slice bounds, in timer ticks.  A thread at PRI_MAX gets
+   thread_slice_min ticks, one at PRI_MIN gets thread_slice_max,
+   and priorities in between are interpolated, so that batch work
+   runs in long slices and high-priority work is not held up.
+   Controlled by kernel command-line option "-ts=MIN:MAX"; by
+   default every thread gets TIME_SLICE. */
+int thread_slice_min = TIME_SLICE;
+int thread_slice_max = TIME_SLICE;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -85,6 +86,7 @@ static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
+static unsigned time_slice (const struct thread *);
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
@@ -95,7 +97,7 @@ static tid_t allocate_tid (void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queue.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -108,15 +110,20 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
+  spinlock_init (&all_lock, "all threads");
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+
+  /* Only now can spinlock_acquire() find the current thread. */
+  spinlock_acquire (&all_lock);
+  list_push_back (&all_list, &initial_thread->allelem);
+  spinlock_release (&all_lock, INTR_OFF);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -124,8 +131,9 @@ thread_init (void)
 void
 thread_start (void) 
 {
-  /* Create the idle thread. */
   struct semaphore idle_started;
+
+  /* Create the idle thread. */
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
@@ -158,18 +166,29 @@ thread_tick (void)
     struct list_elem *e;
     for (e = list_begin(&ready_list); e != list_end(&ready_list); e = list_next(e)) {
       struct thread *ready_thread = list_entry(e, struct thread, elem);
-      if (ready_thread->priority < PRI_MAX) {
+      if (ready_thread->priority < PRI_MAX && !ready_thread->background) {
         ready_thread->priority++; // 우선순위 증가
       }
     }
   }
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++thread_ticks >= time_slice (t))
     intr_yield_on_return ();
 }
 
 
+/* Counts CNT timer ticks that passed while the CPU was idle
+   without taking a timer interrupt.  Called by the timer code in
+   tickless idle. */
+void
+thread_skip_ticks (int64_t cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -269,17 +288,27 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
+  /* A latency-sensitive thread goes ahead of the others at its
+     priority. */
   struct list_elem *e = list_begin(&ready_list);
   while (e != list_end(&ready_list)) 
   {
     struct thread *tmp = list_entry(e, struct thread, elem);
-    if (t->priority > tmp->priority) 
+    if (t->priority > tmp->priority
+        || (t->latency_sensitive && t->priority == tmp->priority))
       break;
     e = list_next(e);
   }
   list_insert(e, &t->elem);
 
   t->status = THREAD_READY;
+
+  /* If an interrupt handler woke it, it also takes the CPU as
+     soon as the handler returns, instead of waiting for the
+     running thread's time slice to end. */
+  if (t->latency_sensitive && intr_context ()
+      && t->priority >= thread_current ()->priority)
+    intr_yield_on_return ();
   intr_set_level (old_level);
 }
 
@@ -336,12 +365,15 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  fpu_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  spinlock_acquire (&all_lock);
   list_remove (&thread_current()->allelem);
+  spinlock_release (&all_lock, INTR_OFF);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -377,7 +409,8 @@ thread_yield(void)
 
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
-   This function must be called with interrupts off. */
+   This function must be called with interrupts off.  FUNC runs
+   with all_lock held, so it must not sleep. */
 void
 thread_foreach (thread_action_func *func, void *aux)
 {
@@ -385,12 +418,14 @@ thread_foreach (thread_action_func *func, void *aux)
 
   ASSERT (intr_get_level () == INTR_OFF);
 
+  spinlock_acquire (&all_lock);
   for (e = list_begin (&all_list); e != list_end (&all_list);
        e = list_next (e))
     {
       struct thread *t = list_entry (e, struct thread, allelem);
       func (t, aux);
     }
+  spinlock_release (&all_lock, INTR_OFF);
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -419,6 +454,46 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
+/* Marks the current thread as latency-sensitive, or not.  A
+   latency-sensitive thread that is woken from an interrupt
+   handler, typically because the I/O it was waiting for
+   completed, preempts any thread of equal or lower priority
+   right away. */
+void
+thread_set_latency_sensitive (bool on)
+{
+  thread_current ()->latency_sensitive = on;
+}
+
+/* Returns true if the current thread is latency-sensitive. */
+bool
+thread_get_latency_sensitive (void)
+{
+  return thread_current ()->latency_sensitive;
+}
+
+/* Makes the current thread a background thread, which runs at
+   PRI_MIN for the rest of its life.  Neither the MLFQS nor aging
+   ever raises its priority, so it only runs when nothing else
+   can. */
+void
+thread_set_background (void)
+{
+  struct thread *t = thread_current ();
+
+  t->background = true;
+  t->priority = PRI_MIN;
+}
+
+/* Returns the number of ticks T may run before it is preempted. */
+static unsigned
+time_slice (const struct thread *t)
+{
+  return (thread_slice_max
+          - ((thread_slice_max - thread_slice_min) * (t->priority - PRI_MIN)
+             / (PRI_MAX - PRI_MIN)));
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice(int nice UNUSED) 
@@ -470,6 +545,7 @@ void update_loadmean(void) {
 
 void update_cpu(void) {
     struct list_elem *element;
+    enum intr_level old_level = spinlock_acquire(&all_lock);
 
     for (element = list_begin(&all_list); element != list_end(&all_list); element = list_next(element)) {
         struct thread *t = list_entry(element, struct thread, allelem);
@@ -480,10 +556,15 @@ void update_cpu(void) {
             t->recent_cpu = (scaling_factor * t->recent_cpu) / FRACTION + t->nice * FRACTION;
         }
     }
+    spinlock_release(&all_lock, old_level);
 }
 void updated_thread_prio(struct thread *t) {
+    if (t->background)
+        return;
+
     int base_priority = PRI_MAX * FRACTION - (t->recent_cpu / 4);
     int nice_adjustment = t->nice * 2 * FRACTION;
+    int old_priority = t->priority;
 
     t->priority = (base_priority - nice_adjustment) / FRACTION;
 
@@ -493,14 +574,22 @@ void updated_thread_prio(struct thread *t) {
     } else if (t->priority < PRI_MIN) {
         t->priority = PRI_MIN;
     }
+
+    // 세마포어에서 대기 중이면 대기 리스트에서 자리를 옮긴다
+    if (t->priority != old_priority && t->status == THREAD_BLOCKED
+        && t->waiting_on != NULL)
+        sema_reorder_waiter(t);
 }
 
 void update_all_thread_priorities(void) {
     struct list_elem *elem;
+    enum intr_level old_level = spinlock_acquire(&all_lock);
+
     for (elem = list_begin(&all_list); elem != list_end(&all_list); elem = list_next(elem)) {
         struct thread *current_thread = list_entry(elem, struct thread, allelem);
         updated_thread_prio(current_thread);
     }
+    spinlock_release(&all_lock, old_level);
 }
 
 void update_priority_and_yield(void) {
@@ -546,7 +635,9 @@ idle (void *idle_started_ UNUSED)
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
+      timer_idle_enter ();
       asm volatile ("sti; hlt" : : : "memory");
+      timer_idle_exit ();
     }
 }
 
@@ -600,29 +691,20 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->magic = THREAD_MAGIC;
 
-  old_level = intr_disable ();
-  list_push_back (&all_list, &t->allelem);
-  intr_set_level (old_level);
+  if (t != initial_thread)
+    {
+      old_level = spinlock_acquire (&all_lock);
+      list_push_back (&all_list, &t->allelem);
+      spinlock_release (&all_lock, old_level);
+    }
 
 
   #ifdef USERPROG
     // 파일 디스크립터 초기화
-    for (int fd_index = 0; fd_index < 128; fd_index++) {
-        t->FD[fd_index] = NULL;
-    }
+    fd_table_init(&t->fds);
 
-    // 세마포어 초기화
-    sema_init(&(t->child_lock), 0);
-    sema_init(&(t->mem_lock), 0);
-    sema_init(&(t->load_lock), 0);
-
-    sema_init(&(t->exec_sema), 0);
-
-    t->parent = running_thread();
-
-    // 자식 스레드 목록 초기화 후 현재 스레드를 부모의 자식 목록에 추가
+    // 자식 프로세스 목록 초기화
     list_init(&t->child_list);
-    list_push_back(&(running_thread()->child_list), &(t->child_elem));
   #endif
 }
 
@@ -706,6 +788,7 @@ thread_schedule_tail (struct thread *prev)
   /* Activate the new address space. */
   process_activate ();
 #endif
+  fpu_activate (cur);
 
   /* If the thread we switched from is dying, destroy its struct
      thread.  This must happen late so that thread_exit() doesn't
@@ -746,14 +829,9 @@ schedule (void)
 static tid_t
 allocate_tid (void) 
 {
-  static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  static volatile tid_t next_tid = 1;
 
-  return tid;
+  return atomic_fetch_add (&next_tid, 1);
 }
 
 /* Offset of `stack' member within `struct thread'.
@@ -5,6 +5,11 @@
 #include <list.h>
 #include <stdint.h>
 #include "synch.h"
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+
+struct child_status;
+#endif
 /* States in a thread's life cycle. */
 enum thread_status
   {
@@ -80,8 +85,6 @@ typedef int tid_t;
    only because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
    blocked state is on a semaphore wait list. */
-struct thread *get_thread_by_tid(tid_t tid);
-
 struct thread
   {
     /* Owned by thread.c. */
@@ -90,37 +93,40 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    bool latency_sensitive;             /* Preempt when woken? */
+    bool background;                    /* Only run when otherwise idle? */
     struct list_elem allelem;   
-    struct semaphore exec_sema;    // 자식 스레드 로드 대기용 세마포어
-    struct thread *parent;           /* List element for all threads list. */
-    bool load_success;
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct semaphore *waiting_on;       /* Semaphore blocked on, if any. */
+
+    /* Owned by threads/fpu.c. */
+    void *fpu;                          /* FXSAVE area, or null. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;   
                    /* Page directory. */
     //추가
-    bool waited; 
-
-    
     int exit_status;                  /* Exit status of process */
-    struct list child_list;           /* List of child processes */
-    struct list_elem child_elem; 
-     /* Element of child_list */
-    // Semaphores작성
-    struct semaphore mem_lock;        
-    struct semaphore child_lock;   
-    struct semaphore load_lock;
-
-    struct file* FD[128];
+    struct list child_list;           /* List of struct child_status. */
+    struct child_status *child_status; /* Our record in parent's list. */
+
+    struct fd_table fds;              /* Open files. */
+
+    /* Owned by userprog/syscall.c. */
+    void *user_esp;                   /* User %esp at system call entry. */
+
+    /* Owned by userprog/exception.c. */
+    void *fault_page;                 /* Page of the last fault. */
+    size_t fault_window;              /* Fault-around window, in pages. */
 #endif
 
     /* Owned by thread.c. */
     unsigned magic;   
     
     int64_t wake_time; 
+    int64_t wake_ns;                    /* timer_now_ns() to wake at. */
     int64_t recent_cpu;                
     int64_t nice;                   
   };
@@ -131,10 +137,16 @@ struct thread
 extern bool thread_mlfqs;
 extern bool thread_aging;
 
+/* Time slices for PRI_MAX and PRI_MIN threads, in timer ticks.
+   Controlled by kernel command-line option "-ts=MIN:MAX". */
+extern int thread_slice_min;
+extern int thread_slice_max;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_skip_ticks (int64_t cnt);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -156,6 +168,9 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_set_latency_sensitive (bool);
+bool thread_get_latency_sensitive (void);
+void thread_set_background (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int nice);
@@ -170,8 +185,6 @@ void update_priority_and_yield(void);
 
 void update_loadmean(void);
 void update_cpu(void);
-struct thread *get_thread_by_tid(tid_t tid);
-
 bool compare_priority(const struct list_elem *first_elem, const struct list_elem *second_elem, void *aux UNUSED);
 int get_max_priority(void);
 #endif /* threads/thread.h */
\ No newline at end of file
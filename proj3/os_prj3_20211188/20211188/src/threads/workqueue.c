@@ -0,0 +1,302 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of workers in system_wq. */
+#define SYSTEM_WORKERS 2
+
+/* A work queue. */
+struct workqueue
+  {
+    const char *name;           /* Name, for worker thread names. */
+    int priority;               /* Priority of the workers. */
+    struct list pending;        /* Work ready to run, in FIFO order. */
+    struct semaphore ready;     /* Number of items in PENDING. */
+  };
+
+/* Delayed work from every queue, ordered by wake-up tick. */
+static struct list delayed_list = LIST_INITIALIZER (delayed_list);
+
+/* Protects delayed_list, every queue's pending list, and the
+   state of every work item.  Work is submitted from interrupt
+   handlers, so this is a spinlock. */
+static struct spinlock work_lock;
+
+/* Broadcast, with done_lock held, whenever any work item
+   finishes a run.  There is one of these for all queues, rather
+   than one per queue, because an item may be resubmitted to a
+   different queue while it runs. */
+static struct lock done_lock;
+static struct condition work_done;
+
+struct workqueue *system_wq;
+
+static thread_func worker;
+static list_less_func work_less;
+
+/* Initializes the work queue system.  Must be called before
+   timer_init(), since the timer interrupt handler takes
+   work_lock. */
+void
+workqueue_init (void)
+{
+  spinlock_init (&work_lock, "work");
+  lock_init (&done_lock);
+  cond_init (&work_done);
+}
+
+/* Creates system_wq.  Must be called after thread_start(). */
+void
+workqueue_start (void)
+{
+  system_wq = workqueue_create ("events", PRI_DEFAULT, SYSTEM_WORKERS);
+  if (system_wq == NULL)
+    PANIC ("cannot create system work queue");
+}
+
+/* Creates a work queue named NAME whose WORKER_CNT workers run at
+   PRIORITY.  Returns the new queue, or a null pointer if memory
+   is short.  Queues live until the kernel shuts down. */
+struct workqueue *
+workqueue_create (const char *name, int priority, size_t worker_cnt)
+{
+  struct workqueue *wq;
+  size_t i;
+
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+  ASSERT (worker_cnt > 0);
+
+  wq = malloc (sizeof *wq);
+  if (wq == NULL)
+    return NULL;
+  wq->name = name;
+  wq->priority = priority;
+  list_init (&wq->pending);
+  sema_init (&wq->ready, 0);
+
+  for (i = 0; i < worker_cnt; i++)
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%zu", name, i);
+      if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+        PANIC ("cannot create worker for work queue %s", name);
+    }
+  return wq;
+}
+
+/* Moves delayed work whose time has come onto its queue.
+   Called by the timer interrupt handler on every tick. */
+void
+workqueue_tick (int64_t now)
+{
+  enum intr_level old_level;
+
+  ASSERT (intr_context ());
+
+  old_level = spinlock_acquire (&work_lock);
+  while (!list_empty (&delayed_list))
+    {
+      struct work *w = list_entry (list_front (&delayed_list),
+                                   struct work, elem);
+      if (w->when > now)
+        break;
+      list_pop_front (&delayed_list);
+      w->state = WORK_PENDING;
+      list_push_back (&w->wq->pending, &w->elem);
+
+      /* sema_up() never yields in interrupt context, so it is
+         safe to call with the spinlock held. */
+      sema_up (&w->wq->ready);
+    }
+  spinlock_release (&work_lock, old_level);
+}
+
+/* Returns the tick at which the earliest delayed work item is
+   due, or INT64_MAX if there is none. */
+int64_t
+workqueue_next_deadline (void)
+{
+  enum intr_level old_level;
+  int64_t deadline = INT64_MAX;
+
+  old_level = spinlock_acquire (&work_lock);
+  if (!list_empty (&delayed_list))
+    deadline = list_entry (list_front (&delayed_list),
+                           struct work, elem)->when;
+  spinlock_release (&work_lock, old_level);
+  return deadline;
+}
+
+/* Initializes W to run FUNC with argument AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->wq = NULL;
+  w->when = 0;
+  w->state = WORK_IDLE;
+  w->requeue = false;
+}
+
+/* Queues W on WQ to be run as soon as a worker is free.  If W
+   is running, it is queued once that run finishes instead.
+   Returns true if successful, false if W was already queued.
+   May be called from an interrupt handler. */
+bool
+work_submit (struct workqueue *wq, struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false, wake = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  old_level = spinlock_acquire (&work_lock);
+  if (w->state == WORK_IDLE)
+    {
+      w->wq = wq;
+      w->state = WORK_PENDING;
+      list_push_back (&wq->pending, &w->elem);
+      queued = wake = true;
+    }
+  else if (w->state == WORK_RUNNING && !w->requeue)
+    {
+      w->wq = wq;
+      w->when = 0;
+      w->requeue = true;
+      queued = true;
+    }
+  spinlock_release (&work_lock, old_level);
+
+  if (wake)
+    sema_up (&wq->ready);
+  return queued;
+}
+
+/* Queues W on WQ to be run once TICKS timer ticks have passed.
+   If W is running, the delay starts now but W is not queued
+   until that run finishes.  Returns true if successful, false if
+   W was already queued.  May be called from an interrupt
+   handler. */
+bool
+work_submit_delayed (struct workqueue *wq, struct work *w, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return work_submit (wq, w);
+
+  old_level = spinlock_acquire (&work_lock);
+  if (w->state == WORK_IDLE)
+    {
+      w->wq = wq;
+      w->when = timer_ticks () + ticks;
+      w->state = WORK_DELAYED;
+      list_insert_ordered (&delayed_list, &w->elem, work_less, NULL);
+      queued = true;
+    }
+  else if (w->state == WORK_RUNNING && !w->requeue)
+    {
+      w->wq = wq;
+      w->when = timer_ticks () + ticks;
+      w->requeue = true;
+      queued = true;
+    }
+  spinlock_release (&work_lock, old_level);
+  return queued;
+}
+
+/* Waits until W, if it has been submitted, has finished running.
+   Must not be called from W's own function. */
+void
+work_wait (struct work *w)
+{
+  ASSERT (!intr_context ());
+
+  lock_acquire (&done_lock);
+  while (w->state != WORK_IDLE)
+    cond_wait (&work_done, &done_lock);
+  lock_release (&done_lock);
+}
+
+/* Worker thread for the work queue passed as WQ_. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  if (wq->priority == PRI_MIN)
+    thread_set_background ();
+
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct workqueue *requeue_wq;
+      struct work *w;
+
+      sema_down (&wq->ready);
+
+      old_level = spinlock_acquire (&work_lock);
+      w = list_entry (list_pop_front (&wq->pending), struct work, elem);
+      w->state = WORK_RUNNING;
+      spinlock_release (&work_lock, old_level);
+
+      w->func (w->aux);
+
+      /* If W was resubmitted while it ran, queue it now that it
+         cannot run twice at once.  Either way it is done only
+         once it is idle. */
+      lock_acquire (&done_lock);
+      old_level = spinlock_acquire (&work_lock);
+      requeue_wq = NULL;
+      if (!w->requeue)
+        w->state = WORK_IDLE;
+      else
+        {
+          w->requeue = false;
+          if (w->when > timer_ticks ())
+            {
+              w->state = WORK_DELAYED;
+              list_insert_ordered (&delayed_list, &w->elem, work_less,
+                                   NULL);
+            }
+          else
+            {
+              requeue_wq = w->wq;
+              w->state = WORK_PENDING;
+              list_push_back (&requeue_wq->pending, &w->elem);
+            }
+        }
+      spinlock_release (&work_lock, old_level);
+      if (requeue_wq != NULL)
+        sema_up (&requeue_wq->ready);
+      cond_broadcast (&work_done, &done_lock);
+      lock_release (&done_lock);
+    }
+}
+
+/* Orders delayed work items by wake-up tick. */
+static bool
+work_less (const struct list_elem *a_, const struct list_elem *b_,
+           void *aux UNUSED)
+{
+  const struct work *a = list_entry (a_, struct work, elem);
+  const struct work *b = list_entry (b_, struct work, elem);
+
+  return a->when < b->when;
+}
@@ -0,0 +1,65 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deferred work.
+
+   A work queue owns a pool of kernel threads that run submitted
+   work items one at a time, in submission order.  Work may be
+   submitted from interrupt context, optionally delayed by a
+   number of timer ticks.  Each queue's workers run at the
+   priority given when the queue was created.  The workers of a
+   queue created at PRI_MIN are background threads (see
+   thread_set_background()), so its work only runs when the CPU
+   would otherwise be idle.
+
+   A work item runs on at most one worker at a time.  If it is
+   resubmitted while it is running, it is queued again only once
+   the current run finishes.
+
+   A work item must stay allocated until it has finished running,
+   so its function must not free it.  It may resubmit it, though. */
+
+/* Function run by a work item. */
+typedef void work_func (void *aux);
+
+/* State of a work item. */
+enum work_state
+  {
+    WORK_IDLE,                  /* Not queued and not running. */
+    WORK_DELAYED,               /* Waiting for its delay to expire. */
+    WORK_PENDING,               /* Waiting for a worker. */
+    WORK_RUNNING                /* Being run by a worker. */
+  };
+
+/* A work item. */
+struct work
+  {
+    struct list_elem elem;      /* Queue's pending or delayed list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    struct workqueue *wq;       /* Queue it was last submitted to. */
+    int64_t when;               /* Tick to run at, if delayed. */
+    enum work_state state;      /* Current state. */
+    bool requeue;               /* Resubmitted while running? */
+  };
+
+/* Queue shared by everyone without special needs. */
+extern struct workqueue *system_wq;
+
+void workqueue_init (void);
+void workqueue_start (void);
+struct workqueue *workqueue_create (const char *name, int priority,
+                                    size_t worker_cnt);
+void workqueue_tick (int64_t now);
+int64_t workqueue_next_deadline (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_submit (struct workqueue *, struct work *);
+bool work_submit_delayed (struct workqueue *, struct work *, int64_t ticks);
+void work_wait (struct work *);
+
+#endif /* threads/workqueue.h */
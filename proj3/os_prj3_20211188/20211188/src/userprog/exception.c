@@ -7,12 +7,19 @@
 #include "threads/vaddr.h"
 
 /* Number of page faults processed. */
-static long long page_fault_cnt;
+static volatile long long page_fault_cnt;
+
+/* Number of page faults that grew the user stack. */
+static volatile long long stack_fault_cnt;
+
+/* Number of user pages mapped by the page fault handler,
+   including pages mapped ahead of the faulting one. */
+static volatile long long fault_page_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 bool is_stack_access(void *fault_addr, void *esp); 
-void expand_stack(void *fault_addr); 
+bool expand_stack(void *fault_addr); 
 /* Registers handlers for interrupts that can be caused by user
    programs.
 
@@ -47,8 +54,6 @@ exception_init (void)
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
   intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
-                     "#NM Device Not Available Exception");
   intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
   intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
   intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -67,6 +72,10 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+  if (fault_page_cnt > 0)
+    printf ("Exception: %lld stack faults mapped %lld pages, "
+            "%lld faults per MB\n", stack_fault_cnt, fault_page_cnt,
+            stack_fault_cnt * (1024 * 1024 / PGSIZE) / fault_page_cnt);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -125,19 +134,33 @@ kill (struct intr_frame *f)
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/atomic.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "userprog/usercopy.h"
 
 /* Number of page faults processed. */
-static long long page_fault_cnt;
+static volatile long long page_fault_cnt;
+
+/* Largest size the user stack may grow to. */
+#define STACK_LIMIT (8 * 1024 * 1024)
+
+/* Number of neighbouring pages mapped around every fault, and
+   the largest window sequential prefetch may grow to.  Both
+   are in pages. */
+#define FAULT_AROUND_PAGES 4
+#define PREFETCH_MAX_PAGES 32
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 bool is_stack_access(void *fault_addr, void *esp);  // 추가함수 선언
-void expand_stack(void *fault_addr);  // 추가함수 선언
+bool expand_stack(void *fault_addr);  // 추가함수 선언
+static bool is_stack_page (const uint8_t *upage);
+static size_t map_stack_pages (uint8_t *upage, int step, size_t cnt);
 
 /* Page fault handler. */
 static void
@@ -152,12 +175,28 @@ page_fault (struct intr_frame *f)
 
   intr_enable ();
 
-  page_fault_cnt++;
+  atomic64_inc (&page_fault_cnt);
 
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
   
+  /* A fault in kernel mode on a user address comes from a
+     system call touching user memory.  The user stack pointer
+     saved at system call entry decides whether the access grows
+     the stack; otherwise the user copy routines recover from it
+     through their fixup table. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      void *esp = thread_current ()->user_esp;
+
+      if (not_present && esp != NULL && is_stack_access (fault_addr, esp)
+          && expand_stack (fault_addr))
+        return;
+      if (usercopy_fixup (f))
+        return;
+    }
+
   // 커널 주소 접근 또는 커널 모드에서 접근 시 종료
   if (is_kernel_vaddr(fault_addr) || !user) {
     EXIT(-1);
@@ -165,8 +204,8 @@ page_fault (struct intr_frame *f)
 
   // 유효한 스택 접근인 경우 스택 확장
   if (not_present && is_user_vaddr(fault_addr) && is_stack_access(fault_addr, f->esp)) {
-    expand_stack(fault_addr);  // 유효한 스택 접근이면 스택 확장
-    return;
+    if (expand_stack(fault_addr))  // 유효한 스택 접근이면 스택 확장
+      return;
   }
 
   EXIT(-1);
@@ -175,19 +214,104 @@ page_fault (struct intr_frame *f)
 /* 추가함수: 스택 접근 유효성 검사 */
 bool is_stack_access(void *fault_addr, void *esp) {
     // 스택 포인터에서 32바이트 이하 접근이 유효한 스택 접근으로 간주
-    return (fault_addr >= esp - 32) && (fault_addr < PHYS_BASE);
+    return (fault_addr >= esp - 32) && is_stack_page (pg_round_down (fault_addr));
 }
 
-/* 추가함수: 스택 확장 */
-void expand_stack(void *fault_addr) {
-    // 페이지를 할당 (사용자 공간에 페이지 할당)
-    void *kpage = palloc_get_page(PAL_USER | PAL_ZERO);
-    if (kpage == NULL) {
-        return;  // 페이지 할당 실패 시 종료
-    }
+/* 추가함수: 스택 확장
+
+   Maps the faulting page and then "faults around" it, mapping
+   up to FAULT_AROUND_PAGES unmapped neighbours above it.  If
+   the previous fault of this thread hit an adjacent page, the
+   access is treated as sequential and the window of pages
+   mapped ahead in that direction doubles on every fault, up to
+   PREFETCH_MAX_PAGES.  Prefetching stops early at the first
+   page that is already resident or when the user pool runs
+   dry.  It does compete with demand faults for the user pool:
+   each sequential fault may take up to PREFETCH_MAX_PAGES
+   zeroed pages that the stack then never touches, and which
+   stay mapped until the process exits.  Returns false if the
+   faulting page itself could not be mapped. */
+bool expand_stack(void *fault_addr) {
+    struct thread *t = thread_current ();
+    uint8_t *upage = pg_round_down (fault_addr);
+    size_t up, down;
+    int step;
+
+    if (map_stack_pages (upage, 0, 1) == 0)
+      return false;  // 페이지 할당 실패 시 종료
+    atomic64_inc (&stack_fault_cnt);
+
+    /* Detect sequential access in either direction. */
+    if (t->fault_page == upage + PGSIZE)
+      step = -PGSIZE;
+    else if (t->fault_page == upage - PGSIZE)
+      step = PGSIZE;
+    else
+      step = 0;
+
+    if (step != 0)
+      {
+        t->fault_window = (t->fault_window < FAULT_AROUND_PAGES
+                           ? FAULT_AROUND_PAGES : t->fault_window * 2);
+        if (t->fault_window > PREFETCH_MAX_PAGES)
+          t->fault_window = PREFETCH_MAX_PAGES;
+      }
+    else
+      t->fault_window = FAULT_AROUND_PAGES;
+
+    /* Pages above the fault are already above ESP, so fill them
+       in towards the resident stack.  Pages below are only
+       mapped ahead of a sequential walk down the stack. */
+    up = map_stack_pages (upage + PGSIZE, PGSIZE,
+                          step > 0 ? t->fault_window : FAULT_AROUND_PAGES);
+    down = step < 0 ? map_stack_pages (upage - PGSIZE, -PGSIZE,
+                                       t->fault_window) : 0;
+    if (step > 0)
+      t->fault_page = upage + up * PGSIZE;
+    else if (step < 0)
+      t->fault_page = upage - down * PGSIZE;
+    else
+      t->fault_page = upage;
+    return true;
+}
+
+/* Returns true if UPAGE lies within the region the user stack
+   may grow into. */
+static bool
+is_stack_page (const uint8_t *upage)
+{
+  return upage >= (uint8_t *) PHYS_BASE - STACK_LIMIT
+         && upage < (uint8_t *) PHYS_BASE;
+}
+
+/* Maps up to CNT zeroed, writable stack pages starting at UPAGE
+   and advancing by STEP bytes between pages (a STEP of 0 maps
+   only UPAGE).  Stops at the first page that is outside the
+   stack region or already mapped, or when no user page is free.
+   Returns the number of pages mapped. */
+static size_t
+map_stack_pages (uint8_t *upage, int step, size_t cnt)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t mapped;
+
+  for (mapped = 0; mapped < cnt; mapped++, upage += step)
+    {
+      void *kpage;
 
-    // 새로 할당한 페이지를 페이지 테이블에 추가
-    if (!pagedir_set_page(thread_current()->pagedir, pg_round_down(fault_addr), kpage, true)) {
-        palloc_free_page(kpage);  // 페이지 테이블에 추가 실패 시 해제
+      if (!is_stack_page (upage) || pagedir_get_page (pd, upage) != NULL)
+        break;
+      kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (kpage == NULL)
+        break;
+      if (!pagedir_set_page (pd, upage, kpage, true))
+        {
+          palloc_free_page (kpage);
+          break;
+        }
+      atomic64_inc (&fault_page_cnt);
+      if (step == 0)
+        return 1;
     }
+  return mapped;
 }
@@ -0,0 +1,131 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* Number of descriptors in the table when first allocated. */
+#define FD_INIT_CAPACITY 32
+
+/* Number of descriptors per word of the `used' bitmap. */
+#define FD_PER_WORD 32
+
+static bool grow (struct fd_table *);
+
+/* Initializes T as an empty table.  Allocates no memory, so it is
+   safe to call before malloc_init(). */
+void
+fd_table_init (struct fd_table *t)
+{
+  t->files = NULL;
+  t->used = NULL;
+  t->summary = 0;
+  t->capacity = 0;
+}
+
+/* Installs FILE in T under the lowest free descriptor and returns
+   it.  Returns -1 if T is full or cannot grow. */
+int
+fd_table_add (struct fd_table *t, struct file *file)
+{
+  int word, fd;
+
+  ASSERT (file != NULL);
+
+  word = t->summary == UINT32_MAX ? FD_MAX / FD_PER_WORD
+                                  : __builtin_ctz (~t->summary);
+  if (word >= t->capacity / FD_PER_WORD && !grow (t))
+    return -1;
+
+  fd = word * FD_PER_WORD + __builtin_ctz (~t->used[word]);
+  t->files[fd] = file;
+  t->used[word] |= 1u << (fd % FD_PER_WORD);
+  if (t->used[word] == UINT32_MAX)
+    t->summary |= 1u << word;
+  return fd;
+}
+
+/* Returns the file open as descriptor FD in T, or a null pointer
+   if FD is not open. */
+struct file *
+fd_table_get (const struct fd_table *t, int fd)
+{
+  if (fd < FD_MIN || fd >= t->capacity)
+    return NULL;
+  return t->files[fd];
+}
+
+/* Removes descriptor FD from T and returns the file it referred
+   to, or a null pointer if FD is not open.  The file is not
+   closed. */
+struct file *
+fd_table_remove (struct fd_table *t, int fd)
+{
+  struct file *file = fd_table_get (t, fd);
+
+  if (file != NULL)
+    {
+      t->files[fd] = NULL;
+      t->used[fd / FD_PER_WORD] &= ~(1u << (fd % FD_PER_WORD));
+      t->summary &= ~(1u << (fd / FD_PER_WORD));
+    }
+  return file;
+}
+
+/* Closes every file open in T and frees T's arrays, leaving T
+   empty.  Only descriptors that are open are visited. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  int word;
+
+  for (word = 0; word < t->capacity / FD_PER_WORD; word++)
+    {
+      uint32_t open = t->used[word];
+
+      if (word == 0)
+        open &= ~((1u << FD_MIN) - 1);
+      while (open != 0)
+        {
+          int bit = __builtin_ctz (open);
+          file_close (t->files[word * FD_PER_WORD + bit]);
+          open &= open - 1;
+        }
+    }
+  free (t->files);
+  free (t->used);
+  fd_table_init (t);
+}
+
+/* Doubles the capacity of T, up to FD_MAX.  Returns true if
+   successful, false if T is at FD_MAX or memory is short. */
+static bool
+grow (struct fd_table *t)
+{
+  int new_capacity = t->capacity == 0 ? FD_INIT_CAPACITY : t->capacity * 2;
+  int old_words = t->capacity / FD_PER_WORD;
+  int new_words = new_capacity / FD_PER_WORD;
+  struct file **files;
+  uint32_t *used;
+
+  if (new_capacity > FD_MAX)
+    return false;
+
+  files = realloc (t->files, new_capacity * sizeof *files);
+  if (files == NULL)
+    return false;
+  t->files = files;
+  used = realloc (t->used, new_words * sizeof *used);
+  if (used == NULL)
+    return false;
+  t->used = used;
+
+  memset (files + t->capacity, 0,
+          (new_capacity - t->capacity) * sizeof *files);
+  memset (used + old_words, 0, (new_words - old_words) * sizeof *used);
+  if (t->capacity == 0)
+    used[0] = (1u << FD_MIN) - 1;
+  t->capacity = new_capacity;
+  return true;
+}
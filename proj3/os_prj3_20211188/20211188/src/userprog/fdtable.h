@@ -0,0 +1,37 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdint.h>
+
+struct file;
+
+/* Lowest file descriptor handed out for an open file.
+   Descriptors 0, 1, and 2 are the console. */
+#define FD_MIN 3
+
+/* Most descriptors a process may have: one bit of `summary' per
+   word of `used', 32 descriptors per word. */
+#define FD_MAX (32 * 32)
+
+/* A process's table of open files.
+
+   The arrays are allocated on the first open and grow by
+   doubling, so `struct thread' only carries this small header.
+   Bit I of `used' is set if descriptor I is taken, and bit W of
+   `summary' is set if word W of `used' is full, which finds the
+   lowest free descriptor with two bit scans. */
+struct fd_table
+  {
+    struct file **files;        /* Open files, indexed by fd. */
+    uint32_t *used;             /* Bitmap of descriptors in use. */
+    uint32_t summary;           /* Bitmap of full words of `used'. */
+    int capacity;               /* Number of descriptors in arrays. */
+  };
+
+void fd_table_init (struct fd_table *);
+int fd_table_add (struct fd_table *, struct file *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+struct file *fd_table_remove (struct fd_table *, int fd);
+void fd_table_destroy (struct fd_table *);
+
+#endif /* userprog/fdtable.h */
@@ -11,9 +11,11 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -22,7 +24,23 @@
 #define FOR1(i, n) for(int i=1; i<=n; i++)
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (char *cmd_line, struct file *file,
+                  void (**eip) (void), void **esp);
+static void release_child_status (struct child_status *);
+
+/* Passed from process_execute() to start_process().  Lives on
+   the parent's stack, which is safe because the parent waits for
+   the child to finish loading before returning. */
+struct exec_info
+  {
+    char *cmd_line;                     /* Page holding the command line. */
+    struct file *file;                  /* Executable, opened by parent. */
+    struct child_status *status;        /* Shared with the parent. */
+  };
+
+/* Maximum number of command-line arguments, including the
+   program name. */
+#define ARGV_MAX 128
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -32,6 +50,8 @@ tid_t
 process_execute (const char *file_name) 
 {
   char *fn_copy;
+  struct exec_info info;
+  struct child_status *cs;
   tid_t tid;
 
   /* Make a copy of FILE_NAME.
@@ -45,7 +65,8 @@ process_execute (const char *file_name)
   char cmd_file[128];
   size_t len = 0;
 
-  while (file_name[len] != '\0' && file_name[len] != ' ') {
+  while (file_name[len] != '\0' && file_name[len] != ' '
+         && len < sizeof cmd_file - 1) {
       cmd_file[len] = file_name[len];
       len++;
   }
@@ -56,22 +77,44 @@ process_execute (const char *file_name)
     palloc_free_page(fn_copy); 
     return TID_ERROR;
   }
-  file_close(file);  
+
+  cs = malloc (sizeof *cs);
+  if (cs == NULL) {
+    file_close (file);
+    palloc_free_page (fn_copy);
+    return TID_ERROR;
+  }
+  cs->exit_code = -1;
+  cs->load_success = false;
+  sema_init (&cs->loaded, 0);
+  sema_init (&cs->exited, 0);
+  lock_init (&cs->ref_lock);
+  cs->ref_cnt = 2;
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (cmd_file, PRI_DEFAULT, start_process, fn_copy);
+  /* The child takes over FILE, so the executable is looked up
+     only once per exec. */
+  info.cmd_line = fn_copy;
+  info.file = file;
+  info.status = cs;
+  tid = thread_create (cmd_file, PRI_DEFAULT, start_process, &info);
   if (tid == TID_ERROR) {
+    file_close (file);
     palloc_free_page (fn_copy);
+    free (cs);
     return TID_ERROR;
   }
-
-  struct thread *child_thread = get_thread_by_tid(tid);
-  if (child_thread != NULL) {
-    sema_down(&(child_thread->load_lock)); // 자식이 load 완료될 때까지 대기
-    if (!child_thread->load_success) {
-        tid = TID_ERROR;
-    }
-}
+  cs->tid = tid;
+  list_push_back (&thread_current ()->child_list, &cs->elem);
+
+  sema_down(&cs->loaded); // 자식이 load 완료될 때까지 대기
+  if (!cs->load_success) {
+    /* Nobody can wait for a child that failed to load, so drop
+       our reference now instead of when we exit. */
+    list_remove (&cs->elem);
+    release_child_status (cs);
+    tid = TID_ERROR;
+  }
   return tid;
 }
 
@@ -81,22 +124,26 @@ process_execute (const char *file_name)
    running. */
 
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct exec_info *info = info_;
+  char *file_name = info->cmd_line;
+  struct child_status *cs = info->status;
   struct intr_frame if_;
   bool success;
 
+  thread_current ()->child_status = cs;
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (file_name, info->file, &if_.eip, &if_.esp);
 
-  thread_current()->load_success = success; // 성공 여부 저장
-  sema_up(&thread_current()->load_lock); // 부모에게 신호 전달
   palloc_free_page(file_name);
+  cs->load_success = success; // 성공 여부 저장
+  sema_up(&cs->loaded); // 부모에게 신호 전달
     
   if (!success) 
     thread_exit();
@@ -125,18 +172,38 @@ start_process (void *file_name_)
 // process_wait 함수에서 자식 종료 시 자원 해제 추가
 int process_wait(tid_t child_tid) {
     struct thread *curr = thread_current();
-    struct thread *child = get_thread_by_tid(child_tid);
-    if (child == NULL || child->waited) return -1;
+    struct list_elem *e;
+
+    for (e = list_begin (&curr->child_list); e != list_end (&curr->child_list);
+         e = list_next (e)) {
+        struct child_status *cs = list_entry (e, struct child_status, elem);
+        if (cs->tid == child_tid) {
+            int exit_code;
+
+            // 자식이 종료될 때까지 대기
+            sema_down(&cs->exited);
+            exit_code = cs->exit_code;
+            list_remove(&cs->elem);
+            release_child_status(cs);
+            return exit_code;
+        }
+    }
+    return -1;
+}
 
-    // 자식이 종료될 때까지 대기
-    sema_down(&(child->child_lock));
+/* Drops one reference to CS, freeing it once both the parent and
+   the child have dropped theirs. */
+static void
+release_child_status (struct child_status *cs)
+{
+  int ref_cnt;
 
-    int exit_status = child->exit_status;
-    list_remove(&(child->child_elem));
-    sema_up(&(child->mem_lock));
-    child->waited = true;
+  lock_acquire (&cs->ref_lock);
+  ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->ref_lock);
 
-    return exit_status;
+  if (ref_cnt == 0)
+    free (cs);
 }
 
 
@@ -168,14 +235,23 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
-    for (int i = 2; i < 128; i++) {
-        if (cur->FD[i] != NULL)
-            file_close(cur->FD[i]);
+    fd_table_destroy(&cur->fds);
+
+    /* Let go of the records of children we never waited for. */
+    while (!list_empty (&cur->child_list)) {
+        struct list_elem *e = list_pop_front (&cur->child_list);
+        release_child_status (list_entry (e, struct child_status, elem));
     }
 
-   
-    sema_up(&(cur->child_lock));
-    sema_down(&(cur->mem_lock));
+    /* Publish our exit code.  Nothing else needs this thread
+       afterward, so its page is freed as soon as we are switched
+       away from. */
+    if (cur->child_status != NULL) {
+        cur->child_status->exit_code = cur->exit_status;
+        sema_up(&cur->child_status->exited);
+        release_child_status(cur->child_status);
+        cur->child_status = NULL;
+    }
 }
 
 /* Sets up the CPU for running user code in the current
@@ -257,25 +333,71 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
+/* A loadable segment, computed from a PT_LOAD program header. */
+struct load_seg
+  {
+    uint32_t file_page;                 /* Page-aligned file offset. */
+    uint32_t mem_page;                  /* Page-aligned user address. */
+    uint32_t read_bytes;                /* Bytes to read from the file. */
+    uint32_t zero_bytes;                /* Bytes to zero after those. */
+    bool writable;                      /* Map pages writable? */
+  };
+
+/* An executable whose headers have been read and validated. */
+struct elf_image
+  {
+    struct inode *inode;                /* Executable's inode. */
+    unsigned version;                   /* inode_version() when parsed. */
+    void (*entry) (void);               /* Entry point. */
+    size_t seg_cnt;                     /* Number of segments. */
+    struct load_seg *segs;              /* Segments to load. */
+  };
+
+/* Cache of parsed executables, so that exec of a binary that was
+   run recently skips reading and validating its headers.  Each
+   entry keeps its inode open, so the inode stays in memory and
+   its version keeps counting writes; an entry whose version is
+   out of date is thrown away on lookup.  Removing the file drops
+   its entry at once, through process_forget_executable(), so
+   that the cache does not keep a deleted file's sectors
+   allocated. */
+#define ELF_CACHE_SIZE 8
+static struct elf_image elf_cache[ELF_CACHE_SIZE];
+static size_t elf_cache_next;           /* Next entry to replace. */
+static struct lock elf_cache_lock;
+
+static bool parse_elf (struct file *, struct elf_image *);
+static bool elf_cache_lookup (struct file *, struct elf_image *);
+static void elf_cache_insert (const struct elf_image *);
+static void elf_cache_evict (struct elf_image *);
+
+/* Initializes the process subsystem. */
+void
+process_init (void)
+{
+  lock_init (&elf_cache_lock);
+}
+
 static bool setup_stack (void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
+/* Loads the ELF executable FILE into the current thread, passing
+   it the arguments in CMD_LINE, which is tokenized in place.
+   Takes ownership of FILE.  Stores the executable's entry point
+   into *EIP and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (char *cmd_line, struct file *file, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
-  off_t file_ofs;
+  struct elf_image img;
   bool success = false;
-  int i;
+  size_t i;
+
+  img.segs = NULL;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -285,35 +407,92 @@ load (const char *file_name, void (**eip) (void), void **esp)
   // 작성
   
   int argc=0;
-  char* argv[128];
-  char copy_file_name[128];
+  char* argv[ARGV_MAX];
   char *token;
   char *next;
 
-  strlcpy(copy_file_name, file_name, sizeof(copy_file_name));
-  token = strtok_r(copy_file_name, " ", &next);
+  /* Arguments are copied onto the single initial stack page. */
+  if (strnlen (cmd_line, PGSIZE / 2) >= PGSIZE / 2)
+    goto done;
+  token = strtok_r(cmd_line, " ", &next);
 
   
   while (token != NULL) {
+    if (argc >= ARGV_MAX - 1)
+      goto done;
     argv[argc] = token;  // Store each argument in argv
     argc++;  // Increment argument count
     token = strtok_r(NULL, " ", &next);  // Get the next token
   }
   argv[argc] = NULL;
-
-  char*  file_name_ptr = argv[0];
   //여기까지
 
+  /* Read and verify the executable's headers, unless we did so
+     recently and the file has not been written since. */
+  if (!elf_cache_lookup (file, &img))
+    {
+      if (!parse_elf (file, &img))
+        {
+          printf ("load: %s: error loading executable\n", argv[0]);
+          goto done; 
+        }
+      elf_cache_insert (&img);
+    }
 
-  /* Open executable file. */
-  file = filesys_open (file_name_ptr);
-  if (file == NULL) 
+  for (i = 0; i < img.seg_cnt; i++) 
     {
-      printf ("load: %s: open failed\n", file_name_ptr);
-      goto done; 
+      const struct load_seg *seg = &img.segs[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
+        goto done;
     }
 
+  /* Set up stack. */
+  if (!setup_stack (esp))
+    goto done;
+  // setup_stack() 다음에:
+  // TODO: construct stack
+  /* Manual p.40
+  • In userprog/process.c, there is setup_stack() which allocates a minimal stack page (4KB).
+  • Since the given code only allocates stack page, we need to make up the stack after setup_stack().
+  • Make up the stack referring to "3.5 80x86 Calling Convention" in Pintos manual
+  */
+  make_stack(argv, esp, argc);
+
+  /* Start address. */
+  *eip = img.entry;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  free (img.segs);
+  file_close (file);
+  return success;
+}
+
+/* load() helpers. */
+
+/* Reads and validates FILE's executable header and program
+   headers, and fills in IMG with the segments to load.  Returns
+   true if successful, false if FILE is not a valid executable.
+   The caller must free IMG->segs either way. */
+static bool
+parse_elf (struct file *file, struct elf_image *img)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
+  /* Sample the version first, so that a write racing with us
+     leaves the entry out of date rather than wrong. */
+  img->inode = file_get_inode (file);
+  img->version = inode_version (img->inode);
+  img->seg_cnt = 0;
+  img->segs = NULL;
+
   /* Read and verify executable header. */
+  file_seek (file, 0);
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
@@ -321,23 +500,22 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_version != 1
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
-    {
-      printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
-    }
+    return false;
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++) 
     {
       struct Elf32_Phdr phdr;
+      struct load_seg *segs, *seg;
+      uint32_t page_offset;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        return false;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        return false;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -351,64 +529,146 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          return false;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (!validate_segment (&phdr, file)) 
+            return false;
+
+          segs = realloc (img->segs, (img->seg_cnt + 1) * sizeof *segs);
+          if (segs == NULL)
+            return false;
+          img->segs = segs;
+          seg = &segs[img->seg_cnt++];
+
+          seg->writable = (phdr.p_flags & PF_W) != 0;
+          seg->file_page = phdr.p_offset & ~PGMASK;
+          seg->mem_page = phdr.p_vaddr & ~PGMASK;
+          page_offset = phdr.p_vaddr & PGMASK;
+          if (phdr.p_filesz > 0)
+            {
+              /* Normal segment.
+                 Read initial part from disk and zero the rest. */
+              seg->read_bytes = page_offset + phdr.p_filesz;
+              seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                 - seg->read_bytes);
+            }
+          else 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else 
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              /* Entirely zero.
+                 Don't read anything from disk. */
+              seg->read_bytes = 0;
+              seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
             }
-          else
-            goto done;
           break;
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-  // setup_stack() 다음에:
-  // TODO: construct stack
-  /* Manual p.40
-  • In userprog/process.c, there is setup_stack() which allocates a minimal stack page (4KB).
-  • Since the given code only allocates stack page, we need to make up the stack after setup_stack().
-  • Make up the stack referring to "3.5 80x86 Calling Convention" in Pintos manual
-  */
-  make_stack(argv, esp, argc);
+  img->entry = (void (*) (void)) ehdr.e_entry;
+  return true;
+}
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+/* Looks up FILE in the executable cache.  If it is there and
+   still up to date, copies it into IMG and returns true.  The
+   caller must free IMG->segs.  Otherwise returns false. */
+static bool
+elf_cache_lookup (struct file *file, struct elf_image *img)
+{
+  struct inode *inode = file_get_inode (file);
+  bool found = false;
+  size_t i;
 
-  success = true;
+  lock_acquire (&elf_cache_lock);
+  for (i = 0; i < ELF_CACHE_SIZE; i++) 
+    {
+      struct elf_image *e = &elf_cache[i];
+      size_t size;
 
- done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
+      if (e->inode != inode)
+        continue;
+      if (e->version != inode_version (inode))
+        {
+          elf_cache_evict (e);
+          break;
+        }
+
+      *img = *e;
+      size = e->seg_cnt * sizeof *e->segs;
+      img->segs = size > 0 ? malloc (size) : NULL;
+      if (img->segs != NULL)
+        memcpy (img->segs, e->segs, size);
+      found = img->segs != NULL || size == 0;
+      break;
+    }
+  lock_release (&elf_cache_lock);
+
+  return found;
+}
+
+/* Adds a copy of IMG to the executable cache, replacing any
+   older entry for the same inode.  Does nothing if memory is
+   short. */
+static void
+elf_cache_insert (const struct elf_image *img)
+{
+  struct elf_image *e = NULL;
+  struct load_seg *segs = NULL;
+  size_t size = img->seg_cnt * sizeof *img->segs;
+  size_t i;
+
+  if (size > 0)
+    {
+      segs = malloc (size);
+      if (segs == NULL)
+        return;
+      memcpy (segs, img->segs, size);
+    }
+
+  lock_acquire (&elf_cache_lock);
+  for (i = 0; i < ELF_CACHE_SIZE; i++)
+    if (elf_cache[i].inode == img->inode || elf_cache[i].inode == NULL)
+      {
+        e = &elf_cache[i];
+        if (e->inode == img->inode)
+          break;
+      }
+  if (e == NULL)
+    {
+      e = &elf_cache[elf_cache_next];
+      elf_cache_next = (elf_cache_next + 1) % ELF_CACHE_SIZE;
+    }
+  if (e->inode != NULL)
+    elf_cache_evict (e);
+
+  *e = *img;
+  e->inode = inode_reopen (img->inode);
+  e->segs = segs;
+  lock_release (&elf_cache_lock);
+}
+
+/* Drops INODE from the executable cache, if it is there.
+   Called when INODE is removed. */
+void
+process_forget_executable (struct inode *inode)
+{
+  size_t i;
+
+  lock_acquire (&elf_cache_lock);
+  for (i = 0; i < ELF_CACHE_SIZE; i++)
+    if (elf_cache[i].inode == inode)
+      elf_cache_evict (&elf_cache[i]);
+  lock_release (&elf_cache_lock);
+}
+
+/* Drops executable cache entry E.
+   The caller must hold elf_cache_lock. */
+static void
+elf_cache_evict (struct elf_image *e)
+{
+  inode_close (e->inode);
+  free (e->segs);
+  e->inode = NULL;
+  e->segs = NULL;
 }
-
-/* load() helpers. */
 
 void make_stack(char* argv[], void **esp, int argc) {
     uintptr_t argv_addresses[128];
@@ -1,11 +1,33 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+struct inode;
+
+/* Exit status of a child process.  Shared by the child and its
+   parent, so that the child's thread can be freed as soon as it
+   exits and the parent can still collect its status later.  The
+   record is freed when both have let go of it. */
+struct child_status
+  {
+    tid_t tid;                          /* Child's thread id. */
+    int exit_code;                      /* Set by the child at exit. */
+    bool load_success;                  /* Set by the child after load. */
+    struct semaphore loaded;            /* Upped once load finishes. */
+    struct semaphore exited;            /* Upped once the child exits. */
+    struct lock ref_lock;               /* Protects ref_cnt. */
+    int ref_cnt;                        /* 2 while both sides hold it. */
+    struct list_elem elem;              /* Element in parent's child_list. */
+  };
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_forget_executable (struct inode *);
 
 #endif /* userprog/process.h */
@@ -1,20 +1,27 @@
 #include "syscall.h"
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/usercopy.h"
 typedef int32_t off_t;
 struct lock lock_file;
 // 시스템 콜 핸들러 함수 선언
 static void syscall_handler(struct intr_frame *);
+static bool get_file_name (char name[NAME_MAX + 2], const char *uname);
+static void *user_page_alias (const void *uaddr, bool write);
 
-// 유효한 사용자 메모리 주소인지 확인하는 함수
-void check_addr(void *addr, unsigned size) {
-    if (addr == NULL || !is_user_vaddr(addr) || !is_user_vaddr((uint8_t *)addr + size - 1)) {
-        EXIT(-1);  // 잘못된 주소 범위일 경우 프로세스 종료
-    }
-}
 struct file {
     struct ino *inode;
     off_t pos;
@@ -26,107 +33,255 @@ void syscall_init(void) {
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* Kinds of system call arguments. */
+enum syscall_arg_type
+  {
+    ARG_INT,                    /* Integer or file descriptor. */
+    ARG_UINT,                   /* Size or position. */
+    ARG_PTR                     /* User address, possibly null. */
+  };
+
+/* Most arguments any system call takes. */
+#define SYSCALL_MAX_ARGS 4
+
+/* A system call handler.  ARGS holds the call's arguments, already
+   copied out of the user stack.  Returns the value for %eax. */
+typedef uint32_t syscall_func (const uint32_t args[]);
+
+/* A system call table entry. */
+struct syscall
+  {
+    const char *name;           /* Name, for statistics. */
+    syscall_func *func;         /* Handler. */
+    int arity;                  /* Number of arguments. */
+    enum syscall_arg_type types[SYSCALL_MAX_ARGS]; /* Argument types. */
+  };
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create,
+  sys_remove, sys_open, sys_filesize, sys_read, sys_write, sys_seek,
+  sys_tell, sys_close, sys_fibonacci, sys_max_of_four_int;
+
+/* System call table, indexed by SYS_* number. */
+static const struct syscall syscalls[] =
+  {
+    [SYS_HALT] = {"halt", sys_halt, 0, {}},
+    [SYS_EXIT] = {"exit", sys_exit, 1, {ARG_INT}},
+    [SYS_EXEC] = {"exec", sys_exec, 1, {ARG_PTR}},
+    [SYS_WAIT] = {"wait", sys_wait, 1, {ARG_INT}},
+    [SYS_CREATE] = {"create", sys_create, 2, {ARG_PTR, ARG_UINT}},
+    [SYS_REMOVE] = {"remove", sys_remove, 1, {ARG_PTR}},
+    [SYS_OPEN] = {"open", sys_open, 1, {ARG_PTR}},
+    [SYS_FILESIZE] = {"filesize", sys_filesize, 1, {ARG_INT}},
+    [SYS_READ] = {"read", sys_read, 3, {ARG_INT, ARG_PTR, ARG_UINT}},
+    [SYS_WRITE] = {"write", sys_write, 3, {ARG_INT, ARG_PTR, ARG_UINT}},
+    [SYS_SEEK] = {"seek", sys_seek, 2, {ARG_INT, ARG_UINT}},
+    [SYS_TELL] = {"tell", sys_tell, 1, {ARG_INT}},
+    [SYS_CLOSE] = {"close", sys_close, 1, {ARG_INT}},
+    [SYS_FIBONACCI] = {"fibonacci", sys_fibonacci, 1, {ARG_INT}},
+    [SYS_MAX_OF_FOUR_INT] = {"max_of_four_int", sys_max_of_four_int, 4,
+                             {ARG_INT, ARG_INT, ARG_INT, ARG_INT}},
+  };
+
+/* Number of entries in syscalls[]. */
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+/* Per-system-call statistics. */
+struct syscall_stats
+  {
+    long long calls;            /* Number of calls. */
+    uint64_t cycles;            /* CPU cycles spent in the handler. */
+  };
+static struct syscall_stats syscall_stats[SYSCALL_CNT];
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 // 시스템 콜 핸들러 함수
-static void syscall_handler(struct intr_frame *f UNUSED) {
-    // 시스템 호출 번호를 저장할 변수
-    int syscall_num = 0;
+static void syscall_handler(struct intr_frame *f) {
+    const struct syscall *sc;
+    uint32_t args[SYSCALL_MAX_ARGS];
+    uint32_t syscall_num;
+    uint64_t start;
+    int i;
+
+    /* Remember the user stack pointer, so that faults on the user
+       stack taken while copying arguments can grow it. */
+    thread_current ()->user_esp = f->esp;
 
     // 시스템 호출 번호를 스택 포인터에서 가져옴
-    syscall_num = *(int *)(f->esp);
+    if (!copy_from_user(&syscall_num, f->esp, sizeof syscall_num))
+        EXIT(-1);
 
-    // 시스템 호출 번호가 음수인 경우 오류 처리
-    if (syscall_num < 0) {
-        printf("Invalid system call number\n");
+    // 지원하지 않는 시스템 호출 번호인 경우 오류 처리
+    if (syscall_num >= SYSCALL_CNT || syscalls[syscall_num].func == NULL) {
+        printf("Unknown system call: %d\n", (int) syscall_num);
         thread_exit();
     }
+    sc = &syscalls[syscall_num];
 
-    // 시스템 호출 번호에 따라 각 기능 처리
-    switch (syscall_num) {
-        case SYS_HALT:
-            HALT();
-            break;
+    /* Fetch all the arguments with a single validated copy. */
+    if (!copy_from_user(args, (uint32_t *) f->esp + 1, sc->arity * sizeof *args))
+        EXIT(-1);
+    for (i = 0; i < sc->arity; i++)
+        if (sc->types[i] == ARG_PTR && !is_user_vaddr((void *) args[i]))
+            EXIT(-1);
 
-        case SYS_EXIT:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            EXIT(*(uint32_t *)(f->esp + 4));
-            break;
+    start = rdtsc();
+    f->eax = sc->func(args);
+    syscall_stats[syscall_num].cycles += rdtsc() - start;
+    syscall_stats[syscall_num].calls++;
+}
 
-        case SYS_EXEC:
-            check_addr(f->esp + 4, sizeof(char *));
-            f->eax = EXEC((const char *)*(uint32_t *)(f->esp + 4));
-            break;
+/* Prints system call statistics. */
+void
+syscall_print_stats (void)
+{
+  size_t i;
+
+  for (i = 0; i < SYSCALL_CNT; i++)
+    if (syscall_stats[i].calls > 0)
+      printf ("Syscall: %s: %lld calls, %"PRIu64" cycles\n",
+              syscalls[i].name, syscall_stats[i].calls,
+              syscall_stats[i].cycles);
+}
 
-        case SYS_WAIT:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            f->eax = WAIT(*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_halt (const uint32_t args[] UNUSED)
+{
+  HALT ();
+  NOT_REACHED ();
+}
 
-        case SYS_CREATE:
-            check_addr(f->esp + 4, sizeof(char *));
-            check_addr(f->esp + 8, sizeof(uint32_t));
-            f->eax = CREATE((const char *)*(uint32_t *)(f->esp + 4), *(uint32_t *)(f->esp + 8));
-            break;
+static uint32_t
+sys_exit (const uint32_t args[])
+{
+  EXIT (args[0]);
+  NOT_REACHED ();
+}
 
-        case SYS_REMOVE:
-            check_addr(f->esp + 4, sizeof(char *));
-            f->eax = REMOVE((const char *)*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_exec (const uint32_t args[])
+{
+  return EXEC ((const char *) args[0]);
+}
 
-        case SYS_FILESIZE:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            f->eax = FILESIZE(*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_wait (const uint32_t args[])
+{
+  return WAIT (args[0]);
+}
 
-        case SYS_OPEN:
-            check_addr(f->esp + 4, sizeof(char *));
-            f->eax = OPEN((const char *)*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_create (const uint32_t args[])
+{
+  return CREATE ((const char *) args[0], args[1]);
+}
 
-        case SYS_SEEK:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            check_addr(f->esp + 8, sizeof(uint32_t));
-            SEEK((int)*(uint32_t *)(f->esp + 4), (unsigned)*(uint32_t *)(f->esp + 8));
-            break;
+static uint32_t
+sys_remove (const uint32_t args[])
+{
+  return REMOVE ((const char *) args[0]);
+}
 
-        case SYS_READ:
-            check_addr((void *)*(uint32_t *)(f->esp + 8), (unsigned)*(uint32_t *)(f->esp + 12));
-            f->eax = READ((int)*(uint32_t *)(f->esp + 4), (void *)*(uint32_t *)(f->esp + 8), (unsigned)*(uint32_t *)(f->esp + 12));
-            break;
+static uint32_t
+sys_open (const uint32_t args[])
+{
+  return OPEN ((const char *) args[0]);
+}
 
-        case SYS_TELL:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            f->eax = TELL(*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_filesize (const uint32_t args[])
+{
+  return FILESIZE (args[0]);
+}
 
-        case SYS_CLOSE:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            CLOSE(*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_read (const uint32_t args[])
+{
+  return READ (args[0], (void *) args[1], args[2]);
+}
 
-        case SYS_WRITE:
-            check_addr((const void *)*(uint32_t *)(f->esp + 8), (unsigned)*(uint32_t *)(f->esp + 12));
-            f->eax = WRITE((int)*(uint32_t *)(f->esp + 4), (const void *)*(uint32_t *)(f->esp + 8), (unsigned)*(uint32_t *)(f->esp + 12));
-            break;
+static uint32_t
+sys_write (const uint32_t args[])
+{
+  return WRITE (args[0], (const void *) args[1], args[2]);
+}
 
-        case SYS_FIBONACCI:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            f->eax = FIBONACCI((int)*(uint32_t *)(f->esp + 4));
-            break;
+static uint32_t
+sys_seek (const uint32_t args[])
+{
+  SEEK (args[0], args[1]);
+  return 0;
+}
 
-        case SYS_MAX_OF_FOUR_INT:
-            check_addr(f->esp + 4, sizeof(uint32_t));
-            check_addr(f->esp + 8, sizeof(uint32_t));
-            check_addr(f->esp + 12, sizeof(uint32_t));
-            check_addr(f->esp + 16, sizeof(uint32_t));
-            f->eax = MAX_OF_FOUR_INT((int)*(uint32_t *)(f->esp + 4), (int)*(uint32_t *)(f->esp + 8), (int)*(uint32_t *)(f->esp + 12), (int)*(uint32_t *)(f->esp + 16));
-            break;
+static uint32_t
+sys_tell (const uint32_t args[])
+{
+  return TELL (args[0]);
+}
 
-        default:
-            printf("Unknown system call: %d\n", syscall_num);
-            thread_exit();
-            break;
+static uint32_t
+sys_close (const uint32_t args[])
+{
+  CLOSE (args[0]);
+  return 0;
+}
+
+static uint32_t
+sys_fibonacci (const uint32_t args[])
+{
+  return FIBONACCI (args[0]);
+}
+
+static uint32_t
+sys_max_of_four_int (const uint32_t args[])
+{
+  return MAX_OF_FOUR_INT (args[0], args[1], args[2], args[3]);
+}
 
+/* Returns the kernel virtual address that aliases user address
+   UADDR if its page is mapped in the current process and, if
+   WRITE is true, writable by it.  Marks the page accessed, and
+   dirty for WRITE, as a user access would have.  Returns a null
+   pointer otherwise. */
+static void *
+user_page_alias (const void *uaddr, bool write)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  const void *upage = pg_round_down (uaddr);
+  void *kaddr;
+
+  if (uaddr == NULL || !is_user_vaddr (uaddr)
+      || (write && !pagedir_is_writable (pd, upage)))
+    return NULL;
+  kaddr = pagedir_get_page (pd, uaddr);
+  if (kaddr != NULL)
+    {
+      pagedir_set_accessed (pd, upage, true);
+      if (write)
+        pagedir_set_dirty (pd, upage, true);
     }
+  return kaddr;
+}
+
+/* Copies the file name at user address UNAME into NAME.  Kills
+   the process if UNAME is not a valid string.  Returns false if
+   the name is longer than NAME_MAX, since no such file can
+   exist. */
+static bool
+get_file_name (char name[NAME_MAX + 2], const char *uname)
+{
+  int len = strncpy_from_user (name, uname, NAME_MAX + 2);
+
+  if (len < 0)
+    EXIT (-1);
+  return len <= NAME_MAX;
 }
 
 // 시스템 종료 함수
@@ -138,20 +293,25 @@ void HALT(void) {
 void EXIT(int status) {
     printf("%s: exit(%d)\n", thread_current()->name, status);
     thread_current()->exit_status = status;
-    for (int i = 3; i < 128; i++) {
-        if (thread_current()->FD[i] != NULL) {
-            CLOSE(i);
-        }
-    }
     thread_exit();
 }
 
 // 프로그램 실행 함수
 int EXEC(const char *cmd_lime) {
-    // process_execute 함수에서 파일을 제대로 처리하고 있는지 확인
-    check_addr((void *)cmd_lime, strlen(cmd_lime) + 1);
+    char *cmd_line = palloc_get_page(0);
+    int len, pid;
+
+    if (cmd_line == NULL)
+        return -1;
+    len = strncpy_from_user(cmd_line, cmd_lime, PGSIZE);
+    if (len < 0) {
+        palloc_free_page(cmd_line);
+        EXIT(-1);
+    }
 
-    int pid = process_execute(cmd_lime);
+    // 명령어가 한 페이지를 넘으면 실행할 수 없음
+    pid = len < PGSIZE ? process_execute(cmd_line) : -1;
+    palloc_free_page(cmd_line);
 
     // 파일을 찾지 못하거나 실행에 실패했을 경우 -1 반환
     if (pid == -1) {
@@ -167,34 +327,38 @@ int WAIT(int pid) {
 }
 
 bool CREATE(const char *file, unsigned size ){
-    if (file == NULL) {
-        EXIT(-1);
-    }
-    bool success = filesys_create(file, size);
+    char name[NAME_MAX + 2];
+
+    if (!get_file_name(name, file))
+        return false;
+    bool success = filesys_create(name, size);
         return success;  
 }
 
 bool REMOVE(const char *file){
-    if(file==NULL){
-        EXIT(-1);
-    }
-    bool success = filesys_remove(file);
+    char name[NAME_MAX + 2];
+
+    if (!get_file_name(name, file))
+        return false;
+    bool success = filesys_remove(name);
         return success; 
 }
 
 int FILESIZE(int fd){
-    if (fd <= 0 || thread_current()->FD[fd] == NULL) {
+    struct file *file = fd_table_get(&thread_current()->fds, fd);
+    if (file == NULL) {
         EXIT(-1);
     }
-    int length = file_length(thread_current()->FD[fd]);
+    int length = file_length(file);
     return length;
 }
 
-int OPEN(const char *file){
-    if (file == NULL) {
-        EXIT(-1);
+int OPEN(const char *file_){
+    char file[NAME_MAX + 2];
+
+    if (!get_file_name(file, file_)) {
+        return -1;
     }
-    check_addr((void *)file, strlen(file) + 1);
     lock_acquire(&lock_file);
 
     struct file *opened_file = filesys_open(file);
@@ -205,15 +369,12 @@ int OPEN(const char *file){
         return fd_index;
     }
     // 할당
-    for (int i = 3; i < 128; i++) {
-        if (thread_current()->FD[i] == NULL) {
-            if (strcmp(thread_current()->name, file) == 0) {
-                file_deny_write(opened_file);
-            }
-            thread_current()->FD[i] = opened_file;
-            fd_index = i;
-            break;
-        }
+    if (strcmp(thread_current()->name, file) == 0) {
+        file_deny_write(opened_file);
+    }
+    fd_index = fd_table_add(&thread_current()->fds, opened_file);
+    if (fd_index < 0) {
+        file_close(opened_file);
     }
 
     lock_release(&lock_file);
@@ -222,81 +383,171 @@ int OPEN(const char *file){
 }
 
 void SEEK(int fd, unsigned position){
-    if (fd < 0 || thread_current()->FD[fd] == NULL) {
+    struct file *file = fd_table_get(&thread_current()->fds, fd);
+    if (file == NULL) {
         EXIT(-1);
     }
-    file_seek(thread_current()->FD[fd], position);
+    file_seek(file, position);
 }
 
 // 데이터 읽기 함수 (파일 디스크립터를 통한 입력 처리)
 int READ(int fd, void *buffer, unsigned size) {
-    if (buffer == NULL || thread_current()->FD[fd] == NULL) {
-        EXIT(-1);
-    }
-
-    check_addr(buffer, size);
+    struct file *file;
+    uint8_t *kbuf = NULL;
+    int bytes_read = 0;
+    bool no_page = false;
 
     if (fd == 0) {
+        uint8_t keys[64];
+        bool was_sensitive = thread_get_latency_sensitive();
+
         lock_acquire(&lock_file);
-        for (unsigned i = 0; i < size; i++) {
-            *((uint8_t *)buffer + i) = input_getc();
+        while ((unsigned) bytes_read < size) {
+            unsigned chunk = size - bytes_read < sizeof keys ? size - bytes_read : sizeof keys;
+
+            /* Run as soon as a key arrives, but only while waiting
+               for one, so a process that reads the keyboard once
+               is not favored for the rest of its life. */
+            thread_set_latency_sensitive(true);
+            for (unsigned i = 0; i < chunk; i++) {
+                keys[i] = input_getc();
+            }
+            thread_set_latency_sensitive(was_sensitive);
+            if (!copy_to_user((uint8_t *)buffer + bytes_read, keys, chunk)) {
+                lock_release(&lock_file);
+                EXIT(-1);
+            }
+            bytes_read += chunk;
         }
         lock_release(&lock_file);
         return size;
     }
-    
-    if (fd > 2) {
-        lock_acquire(&lock_file);
-        int bytes_read = file_read(thread_current()->FD[fd], buffer, size);
-        lock_release(&lock_file);
-        return bytes_read;
+
+    file = fd_table_get(&thread_current()->fds, fd);
+    if (file == NULL) {
+        EXIT(-1);
     }
 
-    return -1;
+    /* Read page by page.  Chunks whose user page is mapped and
+       writable go straight into the process's frame, so whole
+       sectors travel from the block device without any copy;
+       only unmapped pages go through a kernel page, so that a bad
+       user buffer cannot fault inside the file system. */
+    lock_acquire(&lock_file);
+    while ((unsigned) bytes_read < size) {
+        uint8_t *upage = (uint8_t *)buffer + bytes_read;
+        unsigned chunk = PGSIZE - pg_ofs(upage);
+        void *kpage = user_page_alias(upage, true);
+        int n;
+
+        if (chunk > size - bytes_read)
+            chunk = size - bytes_read;
+        if (kpage != NULL) {
+            n = file_read(file, kpage, chunk);
+        } else {
+            if (kbuf == NULL && (kbuf = palloc_get_page(0)) == NULL) {
+                no_page = true;
+                break;
+            }
+            n = file_read(file, kbuf, chunk);
+            if (n > 0 && !copy_to_user(upage, kbuf, n)) {
+                bytes_read = -1;
+                break;
+            }
+        }
+        bytes_read += n;
+        if ((unsigned) n < chunk)
+            break;
+    }
+    lock_release(&lock_file);
+    if (kbuf != NULL)
+        palloc_free_page(kbuf);
+
+    if (bytes_read < 0)
+        EXIT(-1);
+    /* Out of memory before anything was read is an error, not
+       end of file. */
+    if (no_page && bytes_read == 0)
+        return -1;
+    return bytes_read;
 }
 
 unsigned TELL(int fd) {
-    if (thread_current()->FD[fd] == NULL) {
+    struct file *file = fd_table_get(&thread_current()->fds, fd);
+    if (file == NULL) {
         EXIT(-1);
     }
-    return file_tell(thread_current()->FD[fd]);
+    return file_tell(file);
 }
 
 void CLOSE(int fd) {
-    if (thread_current()->FD[fd] == NULL) {
+    struct file *file = fd_table_remove(&thread_current()->fds, fd);
+    if (file == NULL) {
         EXIT(-1);
     }
-    file_close(thread_current()->FD[fd]);
-    thread_current()->FD[fd] = NULL;
+    file_close(file);
 }
 
 
 // 데이터 쓰기 함수 (파일 디스크립터를 통한 출력 처리)
 int WRITE(int fd, const void *buffer, unsigned size) {
-    if (buffer == NULL) {
-        EXIT(-1);
+    struct file *file = NULL;
+    uint8_t *kbuf = NULL;
+    int bytes_written = 0;
+    bool no_page = false;
+
+    if (fd != 1) {
+        if (fd < FD_MIN) {
+            return -1;
+        }
+        file = fd_table_get(&thread_current()->fds, fd);
+        if (file == NULL) {
+            EXIT(-1);
+        }
     }
 
-    check_addr(buffer,size);
-
-    if (fd == 1) {
-        lock_acquire(&lock_file);
-        putbuf(buffer, size);
-        lock_release(&lock_file);
-        return size;
-    } 
-
-    if (fd > 2) {
-        if (thread_current()->FD[fd] == NULL) {
-            EXIT(-1);
+    /* Write page by page, straight from the process's frames
+       where the user page is mapped, and through a kernel page
+       otherwise, as in READ. */
+    lock_acquire(&lock_file);
+    while ((unsigned) bytes_written < size) {
+        const uint8_t *upage = (const uint8_t *)buffer + bytes_written;
+        unsigned chunk = PGSIZE - pg_ofs(upage);
+        const void *kpage = user_page_alias(upage, false);
+        int n;
+
+        if (chunk > size - bytes_written)
+            chunk = size - bytes_written;
+        if (kpage == NULL) {
+            if (kbuf == NULL && (kbuf = palloc_get_page(0)) == NULL) {
+                no_page = true;
+                break;
+            }
+            if (!copy_from_user(kbuf, upage, chunk)) {
+                bytes_written = -1;
+                break;
+            }
+            kpage = kbuf;
         }
-        lock_acquire(&lock_file);
-        int bytes_written = file_write(thread_current()->FD[fd], buffer, size);
-        lock_release(&lock_file);
-        return bytes_written;
+        if (file == NULL) {
+            putbuf(kpage, chunk);
+            n = chunk;
+        } else {
+            n = file_write(file, kpage, chunk);
+        }
+        bytes_written += n;
+        if ((unsigned) n < chunk)
+            break;
     }
+    lock_release(&lock_file);
+    if (kbuf != NULL)
+        palloc_free_page(kbuf);
 
-    return -1;
+    if (bytes_written < 0)
+        EXIT(-1);
+    if (no_page && bytes_written == 0)
+        return -1;
+    return bytes_written;
 }
 
 
@@ -8,6 +8,7 @@ typedef int pid_t;
 extern struct lock lock_file;
 
 void syscall_init(void);
+void syscall_print_stats (void);
 
 void HALT(void);
 void EXIT(int status);
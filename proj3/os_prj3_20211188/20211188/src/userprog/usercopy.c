@@ -0,0 +1,99 @@
+#include "userprog/usercopy.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Raw copy routines and their fixup table, in usercopy-raw.S. */
+int usercopy_raw (void *dst, const void *src, size_t size);
+int usercopy_strncpy_raw (char *dst, const char *src, size_t size);
+
+/* One entry in the fixup table. */
+struct usercopy_fixup
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+extern const struct usercopy_fixup usercopy_fixups[], usercopy_fixups_end[];
+
+/* Returns true if the SIZE bytes starting at user address UADDR
+   all lie below PHYS_BASE.  Whether they are mapped is checked
+   lazily, by the page fault handler. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+
+  return (start != 0
+          && start <= (uintptr_t) PHYS_BASE
+          && size <= (uintptr_t) PHYS_BASE - start);
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Returns true if successful, false if any part of the user
+   range is invalid or unmapped, in which case DST may have been
+   partially written. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  if (size == 0)
+    return true;
+  return is_user_range (usrc, size) && usercopy_raw (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns true if successful, false if any part of the user
+   range is invalid, unmapped, or read-only, in which case UDST
+   may have been partially written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (size == 0)
+    return true;
+  return is_user_range (udst, size) && usercopy_raw (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the length of the
+   string, not counting the null terminator, if it fit.  Returns
+   SIZE if the string is longer than SIZE - 1 bytes, in which
+   case DST is not null-terminated.  Returns -1 if USRC is
+   invalid or unmapped. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  uintptr_t limit;
+  int len;
+
+  ASSERT (size > 0);
+
+  if (usrc == NULL || !is_user_vaddr (usrc))
+    return -1;
+
+  /* Never read past the top of user memory. */
+  limit = (uintptr_t) PHYS_BASE - (uintptr_t) usrc;
+  if (size <= limit)
+    return usercopy_strncpy_raw (dst, usrc, size);
+
+  /* The string runs into kernel memory unless it ends first. */
+  len = usercopy_strncpy_raw (dst, usrc, limit);
+  return (size_t) len < limit ? len : -1;
+}
+
+/* Called by the page fault handler for faults in kernel mode.
+   If the faulting instruction in F is one of the user copy
+   routines, redirects F to its fixup and returns true.
+   Otherwise returns false. */
+bool
+usercopy_fixup (struct intr_frame *f)
+{
+  const struct usercopy_fixup *e;
+
+  for (e = usercopy_fixups; e < usercopy_fixups_end; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}